@@ -0,0 +1,119 @@
+// Pipeline microbenchmark of the data pool and queue: one producer acquires
+// parts from the pool and pushes them into the queue, N consumers pop and
+// release them back -- reports chunks/s for 1 to 64 consumer threads
+//
+#include "../../src/DataPool.h"
+#include "../../src/DataQueue.h"
+
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <chrono>
+#include <cstdlib>
+
+using namespace dsrc;
+using namespace dsrc::core;
+
+
+struct BenchChunk
+{
+	uint64 value;
+
+	BenchChunk(uint64 /*bufferSize_*/)
+		:	value(0)
+	{}
+
+	void Reset()
+	{
+		value = 0;
+	}
+};
+
+typedef TDataPool<BenchChunk> BenchPool;
+typedef TDataQueue<BenchChunk> BenchQueue;
+
+
+static const uint32 PartNum = 32;
+static const uint64 DefaultChunkNum = 1 << 20;
+
+
+void Produce(BenchPool* pool_, BenchQueue* queue_, uint64 chunkNum_)
+{
+	for (uint64 i = 0; i < chunkNum_; ++i)
+	{
+		BenchChunk* part = NULL;
+		pool_->Acquire(part);
+		part->value = i;
+		queue_->Push(i, part);
+	}
+	queue_->SetCompleted();
+}
+
+void Consume(BenchPool* pool_, BenchQueue* queue_, uint64* sum_)
+{
+	int64 partId = 0;
+	BenchChunk* part = NULL;
+	uint64 sum = 0;
+
+	while (queue_->Pop(partId, part))
+	{
+		sum += part->value;
+		pool_->Release(part);
+	}
+	*sum_ = sum;
+}
+
+double RunPipeline(uint32 consumerNum_, uint64 chunkNum_)
+{
+	BenchPool pool(PartNum, 0);
+	BenchQueue queue(PartNum, 1);
+	std::vector<uint64> sums(consumerNum_, 0);
+
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+	std::vector<th::thread> consumers;
+	for (uint32 i = 0; i < consumerNum_; ++i)
+		consumers.push_back(th::thread(Consume, &pool, &queue, &sums[i]));
+
+	Produce(&pool, &queue, chunkNum_);
+
+	for (uint32 i = 0; i < consumerNum_; ++i)
+		consumers[i].join();
+
+	double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+	// every chunk has to be popped exactly once
+	//
+	uint64 sum = 0;
+	for (uint32 i = 0; i < consumerNum_; ++i)
+		sum += sums[i];
+	if (sum != chunkNum_ * (chunkNum_ - 1) / 2)
+	{
+		std::cerr << "Error: chunks lost or duplicated with " << consumerNum_ << " consumers\n";
+		exit(-1);
+	}
+
+	return chunkNum_ / seconds;
+}
+
+
+int main(int argc_, char* argv_[])
+{
+	uint64 chunkNum = DefaultChunkNum;
+	if (argc_ > 1)
+		chunkNum = strtoull(argv_[1], NULL, 10);
+
+	if (argc_ > 2 || chunkNum < 2)
+	{
+		std::cerr << "usage: queuebench [chunks per run, default " << DefaultChunkNum << "]\n";
+		return -1;
+	}
+
+	std::cout << "threads     chunks/s\n";
+	for (uint32 threads = 1; threads <= 64; threads *= 2)
+	{
+		std::cout << std::setw(7) << threads << "  " << std::setw(11) << (uint64)RunPipeline(threads, chunkNum) << std::endl;
+	}
+
+	return 0;
+}
@@ -27,6 +27,8 @@ public:
 
 	void Compress(const std::string& inputFilename_, const std::string& outputFilename_);
 	void Decompress(const std::string& inputFilename_, const std::string& outputFilename_);
+	void DecompressRecords(const std::string& inputFilename_, const std::string& outputFilename_,
+						   uint64 firstRecord_, uint64 recordsCount_);
 	void Usage();
 
 private:
@@ -97,6 +97,7 @@ BOOST_PYTHON_MODULE(pydsrc)
 	boo::class_<DsrcModule, boost::noncopyable>("DsrcModule")
 		.def("Compress", &DsrcModule::Compress)
 		.def("Decompress", &DsrcModule::Decompress)
+		.def("DecompressRecords", &DsrcModule::DecompressRecords)
 		//.def("Usage", &DsrcModule::Usage)
 		.add_property("LossyCompression", &DsrcModule::IsLossyCompression, &DsrcModule::SetLossyCompression)
 		.add_property("DNACompressionLevel", &DsrcModule::GetDnaCompressionLevel, &DsrcModule::SetDnaCompressionLevel)
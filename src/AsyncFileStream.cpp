@@ -0,0 +1,191 @@
+/*
+  This file is a part of DSRC software distributed under GNU GPL 2 licence.
+  The homepage of the DSRC project is http://sun.aei.polsl.pl/dsrc
+  
+  Authors: Lucas Roguski and Sebastian Deorowicz
+  
+  Version: 2.00
+*/
+
+#include "AsyncFileStream.h"
+#include "Common.h"
+
+#include <algorithm>
+
+namespace dsrc
+{
+
+namespace core
+{
+
+AsyncFileStreamWriter::AsyncFileStreamWriter(const std::string& fileName_, bool update_, bool preallocate_,
+											 uint64 bufferSize_, uint32 bufferNum_)
+	:	FileStreamWriterExt(fileName_, update_)
+	,	seekable(IsSeekable())
+	,	preallocate(preallocate_ && seekable)
+	,	preallocatedEnd(0)
+	,	current(NULL)
+	,	currentSize(0)
+	,	currentOffset(0)
+	,	closing(false)
+	,	error(false)
+	,	writerThread(NULL)
+{
+	ASSERT(bufferSize_ > 0);
+	ASSERT(bufferNum_ >= 2);
+
+	for (uint32 i = 0; i < bufferNum_; ++i)
+		buffers.push_back(new Buffer(bufferSize_));
+
+	freeBuffers.assign(buffers.begin() + 1, buffers.end());
+	current = buffers[0];
+
+	writerThread = new th::thread(&AsyncFileStreamWriter::WriteLoop, this);
+}
+
+AsyncFileStreamWriter::~AsyncFileStreamWriter()
+{
+	Stop();
+
+	for (std::vector<Buffer*>::iterator i = buffers.begin(); i != buffers.end(); ++i)
+		delete *i;
+}
+
+int64 AsyncFileStreamWriter::Write(const uchar* mem_, uint64 size_)
+{
+	ASSERT(writerThread != NULL);
+
+	uint64 written = 0;
+	while (written < size_)
+	{
+		const uint64 toCopy = MIN(size_ - written, current->Size() - currentSize);
+		std::copy(mem_ + written, mem_ + written + toCopy, current->Pointer() + currentSize);
+		currentSize += toCopy;
+		written += toCopy;
+
+		if (currentSize == current->Size())
+			Submit();
+	}
+	position += size_;
+
+	return error ? -1 : (int64)size_;
+}
+
+void AsyncFileStreamWriter::SetPosition(uint64 pos_)
+{
+	ASSERT(seekable);
+
+	Submit();
+	position = pos_;
+	currentOffset = pos_;
+}
+
+void AsyncFileStreamWriter::Submit()
+{
+	if (currentSize == 0)
+		return;
+
+	th::unique_lock<th::mutex> lock(mutex);
+
+	WriteRequest request;
+	request.buffer = current;
+	request.offset = currentOffset;
+	request.size = currentSize;
+	pendingWrites.push(request);
+	pendingCondition.notify_one();
+
+	currentOffset += currentSize;
+	currentSize = 0;
+
+	while (freeBuffers.size() == 0)
+		freeCondition.wait(lock);
+
+	current = freeBuffers.back();
+	freeBuffers.pop_back();
+}
+
+void AsyncFileStreamWriter::Flush()
+{
+	Submit();
+
+	th::unique_lock<th::mutex> lock(mutex);
+	while (freeBuffers.size() + 1 < buffers.size())
+		freeCondition.wait(lock);
+}
+
+void AsyncFileStreamWriter::Close()
+{
+	Stop();
+
+	if (preallocate)
+		ReleasePreallocated();
+
+	FileStreamWriter::Close();
+}
+
+void AsyncFileStreamWriter::Stop()
+{
+	if (writerThread == NULL)
+		return;
+
+	Submit();
+
+	{
+		th::lock_guard<th::mutex> lock(mutex);
+		closing = true;
+		pendingCondition.notify_one();
+	}
+
+	writerThread->join();
+	delete writerThread;
+	writerThread = NULL;
+}
+
+void AsyncFileStreamWriter::WriteLoop()
+{
+	for ( ;; )
+	{
+		WriteRequest request;
+		{
+			th::unique_lock<th::mutex> lock(mutex);
+			while (pendingWrites.size() == 0 && !closing)
+				pendingCondition.wait(lock);
+
+			if (pendingWrites.size() == 0)
+				break;
+
+			request = pendingWrites.front();
+			pendingWrites.pop();
+		}
+
+		// after a failure the remaining data is dropped
+		//
+		if (!error)
+		{
+			const uint64 end = request.offset + request.size;
+			if (preallocate && end > preallocatedEnd)
+			{
+				const uint64 begin = MAX(preallocatedEnd, request.offset);
+				preallocatedEnd = MAX(end, begin + PreallocationStep);
+				Preallocate(begin, preallocatedEnd - begin);
+			}
+
+			int64 n;
+			if (seekable)
+				n = WriteAt(request.offset, request.buffer->Pointer(), request.size);
+			else
+				n = FileStreamWriter::Write(request.buffer->Pointer(), request.size);
+
+			if (n != (int64)request.size)
+				error = true;
+		}
+
+		th::lock_guard<th::mutex> lock(mutex);
+		freeBuffers.push_back(request.buffer);
+		freeCondition.notify_one();
+	}
+}
+
+} // namespace core
+
+} // namespace dsrc
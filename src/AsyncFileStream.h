@@ -0,0 +1,105 @@
+/*
+  This file is a part of DSRC software distributed under GNU GPL 2 licence.
+  The homepage of the DSRC project is http://sun.aei.polsl.pl/dsrc
+  
+  Authors: Lucas Roguski and Sebastian Deorowicz
+  
+  Version: 2.00
+*/
+#ifndef H_ASYNCFILESTREAM
+#define H_ASYNCFILESTREAM
+
+#include "../include/dsrc/Globals.h"
+
+#include <vector>
+#include <queue>
+
+#include "FileStream.h"
+#include "Buffer.h"
+
+#ifdef USE_BOOST_THREAD
+#include <boost/thread.hpp>
+#include <boost/atomic.hpp>
+namespace th = boost;
+#else
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+namespace th = std;
+#endif
+
+namespace dsrc
+{
+
+namespace core
+{
+
+// write-behind file stream: the data is gathered in buffers written by a separate
+// thread with positional writes (sequentially for pipes), a buffer returns to the
+// free list only when its write completes
+//
+class AsyncFileStreamWriter : public FileStreamWriterExt
+{
+public:
+	static const uint64 DefaultBufferSize = 1 << 22;
+	static const uint32 DefaultBufferNum = 4;
+	static const uint64 PreallocationStep = 1 << 26;
+
+	AsyncFileStreamWriter(const std::string& fileName_, bool update_ = false, bool preallocate_ = false,
+						  uint64 bufferSize_ = DefaultBufferSize, uint32 bufferNum_ = DefaultBufferNum);
+	~AsyncFileStreamWriter();
+
+	// returns -1 when any of the previous writes failed
+	int64 Write(const uchar* mem_, uint64 size_);
+
+	void SetPosition(uint64 pos_);
+
+	// waits for all the pending writes
+	void Flush();
+
+	void Close();
+
+	bool IsError() const
+	{
+		return error;
+	}
+
+private:
+	struct WriteRequest
+	{
+		Buffer* buffer;
+		uint64 offset;
+		uint64 size;
+	};
+
+	const bool seekable;
+	const bool preallocate;
+	uint64 preallocatedEnd;
+
+	std::vector<Buffer*> buffers;
+	std::vector<Buffer*> freeBuffers;
+	std::queue<WriteRequest> pendingWrites;
+
+	Buffer* current;
+	uint64 currentSize;
+	uint64 currentOffset;
+
+	bool closing;
+	th::atomic<bool> error;			// set by the writer thread
+
+	th::mutex mutex;
+	th::condition_variable pendingCondition;
+	th::condition_variable freeCondition;
+	th::thread* writerThread;
+
+	void Submit();
+	void WriteLoop();
+	void Stop();
+};
+
+} // namespace core
+
+} // namespace dsrc
+
+#endif // H_ASYNCFILESTREAM
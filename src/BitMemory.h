@@ -133,7 +133,7 @@ public:
 		return memory[position++];
 	}
 
-	void GetBytes(uchar *data, uint32 n_bytes)
+	void GetBytes(uchar *data, uint64 n_bytes)
 	{
 		ASSERT(position + n_bytes <= size);
 
@@ -167,7 +167,22 @@ public:
 		return GetByte() << 8 | GetByte();
 	}
 
-	void SkipBytes(uint32 n_)
+	// 7 bits per byte, least significant group first
+	//
+	uint64 GetVarDWord()
+	{
+		uint64 c = 0;
+		for (uint32 shift = 0; shift < 64; shift += 7)
+		{
+			byte b = GetByte();
+			c |= (uint64)(b & 0x7F) << shift;
+			if ((b & 0x80) == 0)
+				break;
+		}
+		return c;
+	}
+
+	void SkipBytes(uint64 n_)
 	{
 		ASSERT(position + n_ < size);
 
@@ -217,7 +232,7 @@ class BitMemoryWriter
 public:
 	static const uint32 DefaultBufferSize = 1 << 20;
 
-	BitMemoryWriter(uint32 bufferSize_ = DefaultBufferSize)
+	BitMemoryWriter(uint64 bufferSize_ = DefaultBufferSize)
 		:	buffer(NULL)
 		,	position(0)
 		,	wordBuffer(0)
@@ -353,11 +368,11 @@ public:
 		PutByte((uchar)(word_ & 0xFF));
 	}
 
-	void PutBytes(const byte *data_, uint32 n_)
+	void PutBytes(const byte *data_, uint64 n_)
 	{
 		if (position + n_ > size)
 		{
-			ExtendBuffer((uint32)((position + n_) * 1.5f));
+			ExtendBuffer((position + n_) + ((position + n_) >> 1));
 		}
 		std::copy(data_, data_ + n_, memory + position);
 		position += n_;
@@ -383,6 +398,16 @@ public:
 		PutByte(data_ & 0xFF);
 	}
 
+	void PutVarDWord(uint64 data_)
+	{
+		while (data_ >= 0x80)
+		{
+			PutByte((data_ & 0x7F) | 0x80);
+			data_ >>= 7;
+		}
+		PutByte(data_);
+	}
+
 	void FlushFullWordBuffer()
 	{
 		PutWord(wordBuffer);
@@ -463,7 +488,7 @@ private:
 		return ((uint32)1 << n_) - 1;
 	}
 
-	void ExtendBuffer(uint32 newSize_)
+	void ExtendBuffer(uint64 newSize_)
 	{
 		ASSERT(newSize_ > 0);
 
@@ -19,6 +19,14 @@
 
 #include "utils.h"
 
+#ifdef USE_BOOST_THREAD
+#include <boost/thread.hpp>
+namespace th = boost;
+#else
+#include <thread>
+namespace th = std;
+#endif
+
 namespace dsrc
 {
 
@@ -50,12 +58,19 @@ inline void CONTROL_CHECK_R(BitMemoryReader& r_)
 #endif
 
 
-BlockCompressor::BlockCompressor(const FastqDatasetType& type_, const CompressionSettings& settings_)
+BlockCompressor::BlockCompressor(const FastqDatasetType& type_, const CompressionSettings& settings_,
+								 bool parallelStreams_)
 	:	datasetType(type_)
 	,	compSettings(settings_)
 	,	recordsProcessor(NULL)
 	,	dnaModeler(NULL)
 	,	qualityModeler(NULL)
+	,	parallelStreams(parallelStreams_)
+	,	qualityMemory(NULL)
+	,	dnaMemory(NULL)
+	,	dnaReader(NULL)
+	,	qualityThread(NULL)
+	,	dnaThread(NULL)
 {
 	records.resize(8 * 1024);
 
@@ -96,12 +111,49 @@ BlockCompressor::BlockCompressor(const FastqDatasetType& type_, const Compressio
 
 BlockCompressor::~BlockCompressor()
 {
+	delete dnaThread;
+	delete qualityThread;
+	delete dnaMemory;
+	delete qualityMemory;
 	delete qualityModeler;
 	delete dnaModeler;
 	delete recordsProcessor;
 }
 
 
+bool BlockCompressor::UseParallelStreams(uint32 blockThreadsNum_)
+{
+	return blockThreadsNum_ * StreamThreadsNum <= th::thread::hardware_concurrency();
+}
+
+
+uint64 BlockCompressor::EstimateMemorySize(const CompressionSettings& settings_, uint64 blockSize_, bool parallelStreams_)
+{
+	uint64 size = sizeof(BlockCompressor);
+
+	if (settings_.dnaOrder > 0)
+		size += DnaOrderModelerProxy::MemorySize(settings_.dnaOrder);
+
+	if (settings_.qualityOrder > 0)
+	{
+		if (settings_.lossy)
+			size += QualityOrderModelerProxyLossy::MemorySize(settings_.qualityOrder);
+		else
+			size += QualityOrderModelerProxyLossless::MemorySize(settings_.qualityOrder);
+	}
+
+	// with parallel streams the records are copied for the dna thread when
+	// decoding and the quality and dna streams get separate buffers
+	//
+	const uint64 recordsSize = blockSize_ / EstimatedRecordSize * sizeof(FastqRecord);
+	size += recordsSize;
+	if (parallelStreams_)
+		size += recordsSize + blockSize_ / 2;
+
+	return size;
+}
+
+
 void BlockCompressor::Reset()
 {
 	chunkHeader.flags = 0;
@@ -202,11 +254,28 @@ void BlockCompressor::AnalyzeMetaData(const DnaStats& , const QualityStats& qSta
 	{
 		chunkHeader.flags |= FLAG_VARIABLE_LENGTH;
 	}
+
+	chunkHeader.flags |= FLAG_STREAM_OFFSETS | FLAG_LARGE_SIZES | FLAG_AMBIGUOUS_SYMBOLS;
+
+	if (compSettings.dnaOrder > 0 && (compSettings.ransStreams & CompressionSettings::RANS_DNA) != 0)
+		chunkHeader.flags |= FLAG_RANS_DNA;
+
+	if (compSettings.qualityOrder > 0 && (compSettings.ransStreams & CompressionSettings::RANS_QUALITY) != 0)
+		chunkHeader.flags |= FLAG_RANS_QUALITY;
+
+	SelectEntropyCoders();
+}
+
+
+void BlockCompressor::SelectEntropyCoders()
+{
+	dnaModeler->SetEntropyCoder((chunkHeader.flags & FLAG_RANS_DNA) != 0 ? EntropyCoder::Rans : EntropyCoder::Range);
+	qualityModeler->SetEntropyCoder((chunkHeader.flags & FLAG_RANS_QUALITY) != 0 ? EntropyCoder::Rans : EntropyCoder::Range);
 }
 
 
-void BlockCompressor::Store(BitMemoryWriter &memory_, StreamsInfo& rawStreamInfo_, StreamsInfo& compStreamInfo_,
-							const FastqDataChunk &chunk_)
+uint64 BlockCompressor::Store(BitMemoryWriter &memory_, StreamsInfo& rawStreamInfo_, StreamsInfo& compStreamInfo_,
+							  const FastqDataChunk &chunk_)
 {
 	ParseRecords(chunk_, rawStreamInfo_);
 
@@ -216,34 +285,91 @@ void BlockCompressor::Store(BitMemoryWriter &memory_, StreamsInfo& rawStreamInfo
 
 	StoreRecords(memory_, compStreamInfo_);
 
+	const uint64 recordsCount = chunkHeader.recordsCount;
+
 	Reset();
+
+	return recordsCount;
 }
 
 
 void BlockCompressor::StoreRecords(BitMemoryWriter &memory_, StreamsInfo& streamInfo_)
 {
-	uint64 pos = memory_.Position();
+	ASSERT((chunkHeader.flags & FLAG_STREAM_OFFSETS) != 0);
+	ASSERT((chunkHeader.flags & FLAG_LARGE_SIZES) != 0);
 
-	// store meta data
+	const uint64 blockPos = memory_.Position();
+	uint64 pos = blockPos;
+
+	// store meta data -- the streams offsets table closes it
+	// and will be filled at the end
 	//
 	CONTROL_CHECK_W(memory_);
+	const uint64 metaPos = memory_.Position();
 	StoreMetaData(memory_);
 
+	const uint64 offsetsPos = memory_.Position() - ChunkHeader::StreamOffsetsCount * sizeof(uint64);
+
 	streamInfo_.sizes[StreamsInfo::MetaStream] = memory_.Position() - pos;
 	pos = memory_.Position();
 
-	// store tags
+	// start encoding quality and dna, they depend only on the analyzed
+	// records and are appended once the tags are stored
 	//
-	CONTROL_CHECK_W(memory_);
-	StoreTags(memory_);
+	if (parallelStreams)
+	{
+		if (qualityMemory == NULL)
+		{
+			qualityMemory = new BitMemoryWriter();
+			dnaMemory = new BitMemoryWriter();
+		}
 
-	streamInfo_.sizes[StreamsInfo::TagStream] = memory_.Position() - pos;
-	pos = memory_.Position();
+		if (qualityThread == NULL)
+			qualityThread = new TStreamThread<BlockCompressor>(this);
+		if (dnaThread == NULL)
+			dnaThread = new TStreamThread<BlockCompressor>(this);
+
+		qualityThread->Start(&BlockCompressor::StoreQualityStream);
+		dnaThread->Start(&BlockCompressor::StoreDnaStream);
+	}
+
+	// store lengths and tags -- on error the helpers still using
+	// the records are waited for before it is passed on
+	//
+	try
+	{
+		CONTROL_CHECK_W(memory_);
+		StoreLengths(memory_);
+
+		CONTROL_CHECK_W(memory_);
+		chunkHeader.streamOffsets[ChunkHeader::TagStreamOffset] = memory_.Position() - blockPos;
+		StoreTags(memory_);
+
+		streamInfo_.sizes[StreamsInfo::TagStream] = memory_.Position() - pos;
+		pos = memory_.Position();
+	}
+	catch (...)
+	{
+		WaitStreamThreads();
+		throw;
+	}
+
+	if (parallelStreams)
+	{
+		WaitStreamThreads();
+
+		qualityThread->CheckError();
+		dnaThread->CheckError();
+	}
 
 	// store quality
 	//
 	CONTROL_CHECK_W(memory_);
-	StoreQuality(memory_);
+	chunkHeader.streamOffsets[ChunkHeader::QualityStreamOffset] = memory_.Position() - blockPos;
+	if (parallelStreams)
+		memory_.PutBytes(qualityMemory->Pointer(), qualityMemory->Position());
+	else
+		StoreQuality(memory_);
 
 	streamInfo_.sizes[StreamsInfo::QualityStream] = memory_.Position() - pos;
 	pos = memory_.Position();
@@ -251,11 +377,41 @@ void BlockCompressor::StoreRecords(BitMemoryWriter &memory_, StreamsInfo& stream
 	// store dna
 	//
 	CONTROL_CHECK_W(memory_);
-	StoreDNA(memory_);
+	chunkHeader.streamOffsets[ChunkHeader::DnaStreamOffset] = memory_.Position() - blockPos;
+	if (parallelStreams)
+		memory_.PutBytes(dnaMemory->Pointer(), dnaMemory->Position());
+	else
+		StoreDNA(memory_);
+
+	// store ambiguous symbols moved to quality stream -- they only speed up
+	// decoding dna alone, so are dropped when costing too much of the block
+	//
+	const uint64 ambPos = memory_.Position();
+	CONTROL_CHECK_W(memory_);
+	chunkHeader.streamOffsets[ChunkHeader::AmbiguousStreamOffset] = memory_.Position() - blockPos;
+	StoreAmbiguousSymbols(memory_);
+
+	if ((memory_.Position() - ambPos) * MaxAmbiguousStreamRatio > ambPos - blockPos)
+	{
+		memory_.SetPosition(ambPos);
+		chunkHeader.flags &= ~FLAG_AMBIGUOUS_SYMBOLS;
+		chunkHeader.streamOffsets[ChunkHeader::AmbiguousStreamOffset] = 0;
+	}
 
 	streamInfo_.sizes[StreamsInfo::DnaStream] = memory_.Position() - pos;
 
 	CONTROL_CHECK_W(memory_);
+
+	// fill the flags and the streams offsets table
+	//
+	const uint64 endPos = memory_.Position();
+	memory_.SetPosition(metaPos + 2 * sizeof(uint32));
+	memory_.PutWord(chunkHeader.flags);
+
+	memory_.SetPosition(offsetsPos);
+	for (uint32 i = 0; i < ChunkHeader::StreamOffsetsCount; ++i)
+		memory_.PutDWord(chunkHeader.streamOffsets[i]);
+	memory_.SetPosition(endPos);
 }
 
 
@@ -269,8 +425,91 @@ void BlockCompressor::Read(BitMemoryReader &memory_, FastqDataChunk &chunk)
 }
 
 
+void BlockCompressor::Read(BitMemoryReader &memory_, FastqDataChunk &chunk_, uint64 skipRecords_, uint64 recordsCount_,
+						   OutputFormat::FormatEnum format_)
+{
+	switch (format_)
+	{
+		case OutputFormat::Fasta:
+		case OutputFormat::SequencesOnly:
+			ReadProjectedRecords(memory_, chunk_, format_);
+			break;
+
+		case OutputFormat::TagsOnly:
+			ReadTagRecords(memory_, chunk_);
+			break;
+
+		default:
+			ReadRecords(memory_, chunk_);
+			PostprocessRecords(fq::FastqChecksum::CALC_NONE);
+	}
+
+	SelectRecords(chunk_, skipRecords_, recordsCount_, format_);
+
+	Reset();
+}
+
+
+uint32 BlockCompressor::ReadRecordsCount(BitMemoryReader &memory_)
+{
+	CONTROL_CHECK_R(memory_);
+	return memory_.GetWord();
+}
+
+
+uint64 BlockCompressor::ReadChunkSize(BitMemoryReader &memory_)
+{
+	// records count, max quality length and flags precede the size
+	//
+	CONTROL_CHECK_R(memory_);
+	memory_.GetWord();
+	memory_.GetWord();
+
+	const uint32 flags = memory_.GetWord();
+	return (flags & FLAG_LARGE_SIZES) != 0 ? memory_.GetDWord() : memory_.GetWord();
+}
+
+
+void BlockCompressor::SelectRecords(FastqDataChunk &chunk_, uint64 skipRecords_, uint64 recordsCount_,
+									OutputFormat::FormatEnum format_)
+{
+	ASSERT(skipRecords_ < chunkHeader.recordsCount);
+	ASSERT(recordsCount_ > 0);
+
+	if (recordsCount_ > chunkHeader.recordsCount - skipRecords_)
+		recordsCount_ = chunkHeader.recordsCount - skipRecords_;
+
+	if (skipRecords_ == 0 && recordsCount_ == chunkHeader.recordsCount)
+		return;
+
+	// records are stored consecutively in the chunk, so we only need
+	// to cut out the selected range -- when outputting sequences only
+	// the records begin with the sequence instead of the title
+	//
+	const bool sequencesOnly = format_ == OutputFormat::SequencesOnly;
+	const FastqRecord& beginRec = records[skipRecords_];
+
+	uchar* chunkBegin = chunk_.data.Pointer();
+	uchar* selBegin = sequencesOnly ? beginRec.sequence : beginRec.title;
+	uchar* selEnd = chunkBegin + chunk_.size;
+	if (skipRecords_ + recordsCount_ < chunkHeader.recordsCount)
+	{
+		const FastqRecord& endRec = records[skipRecords_ + recordsCount_];
+		selEnd = sequencesOnly ? endRec.sequence : endRec.title;
+	}
+
+	ASSERT(selBegin >= chunkBegin && selEnd <= chunkBegin + chunk_.size);
+
+	if (selBegin != chunkBegin)
+		std::copy(selBegin, selEnd, chunkBegin);
+	chunk_.size = selEnd - selBegin;
+}
+
+
 void BlockCompressor::ReadRecords(BitMemoryReader &memory_, FastqDataChunk &chunk_)
 {
+	const uint64 blockPos = memory_.Position();
+
 	CONTROL_CHECK_R(memory_);
 	ReadMetaData(memory_);
 
@@ -284,16 +523,278 @@ void BlockCompressor::ReadRecords(BitMemoryReader &memory_, FastqDataChunk &chun
 		chunk_.data.Extend(chunkHeader.chunkSize + MEM_EXTENSION_FACTOR(chunkHeader.chunkSize));
 	}
 
-	CONTROL_CHECK_R(memory_);
+	if ((chunkHeader.flags & FLAG_STREAM_OFFSETS) != 0)
+	{
+		CONTROL_CHECK_R(memory_);
+		ReadLengths(memory_);
+	}
+
+	SeekStream(memory_, blockPos, ChunkHeader::TagStreamOffset);
 	ReadTags(memory_, chunk_);
 
-	CONTROL_CHECK_R(memory_);
+	// the tags have laid out the records, so quality and dna are decoded
+	// into disjoint parts of the chunk
+	//
+	if (parallelStreams && (chunkHeader.flags & FLAG_AMBIGUOUS_SYMBOLS) != 0)
+	{
+		ReadStreamsParallel(memory_, blockPos);
+		return;
+	}
+
+	SeekStream(memory_, blockPos, ChunkHeader::QualityStreamOffset);
 	ReadQuality(memory_);
 
+	SeekStream(memory_, blockPos, ChunkHeader::DnaStreamOffset);
+	ReadDNA(memory_);
+
+	if ((chunkHeader.flags & FLAG_STREAM_OFFSETS) == 0)
+		CONTROL_CHECK_R(memory_);
+}
+
+
+void BlockCompressor::ReadStreamsParallel(BitMemoryReader &memory_, uint64 blockPos_)
+{
+	// the dna decoder needs only the sequences lengths, which are known from
+	// the ambiguous symbols without decoding quality -- the symbols themselves
+	// are restored from quality afterwards, as in the sequential path
+	//
+	SeekStream(memory_, blockPos_, ChunkHeader::AmbiguousStreamOffset);
+	ReadAmbiguousSymbols(memory_);
+
+	dnaRecords.assign(records.begin(), records.begin() + chunkHeader.recordsCount);
+
+	BitMemoryReader reader(memory_.Pointer(), memory_.Size());
+	reader.SetPosition(blockPos_ + chunkHeader.streamOffsets[ChunkHeader::DnaStreamOffset]);
+
+	if (dnaThread == NULL)
+		dnaThread = new TStreamThread<BlockCompressor>(this);
+
+	dnaReader = &reader;
+	dnaThread->Start(&BlockCompressor::ReadDnaStream);
+
+	try
+	{
+		SeekStream(memory_, blockPos_, ChunkHeader::QualityStreamOffset);
+		ReadQuality(memory_);
+	}
+	catch (...)
+	{
+		WaitStreamThreads();
+		throw;
+	}
+
+	WaitStreamThreads();
+	dnaThread->CheckError();
+
+	memory_.SetPosition(reader.Position());
+}
+
+
+void BlockCompressor::WaitStreamThreads()
+{
+	if (qualityThread != NULL)
+		qualityThread->Wait();
+	if (dnaThread != NULL)
+		dnaThread->Wait();
+}
+
+
+void BlockCompressor::SeekStream(BitMemoryReader &memory_, uint64 blockPos_, uint32 stream_)
+{
+	// older blocks can be read only sequentially
+	//
+	if ((chunkHeader.flags & FLAG_STREAM_OFFSETS) == 0)
+	{
+		CONTROL_CHECK_R(memory_);
+		return;
+	}
+
+	ASSERT(stream_ < ChunkHeader::StreamOffsetsCount);
+	memory_.FlushInputWordBuffer();
+	memory_.SetPosition(blockPos_ + chunkHeader.streamOffsets[stream_]);
+}
+
+
+void BlockCompressor::ReadSequencesOnly(BitMemoryReader &memory_, FastqDataChunk &chunk_)
+{
+	ReadProjectedRecords(memory_, chunk_, OutputFormat::SequencesOnly);
+
+	Reset();
+}
+
+
+void BlockCompressor::ReadProjectedRecords(BitMemoryReader &memory_, FastqDataChunk &chunk_, OutputFormat::FormatEnum format_)
+{
+	ASSERT(format_ == OutputFormat::Fasta || format_ == OutputFormat::SequencesOnly);
+
+	const uint64 blockPos = memory_.Position();
+	const bool withTitles = format_ == OutputFormat::Fasta;
+
 	CONTROL_CHECK_R(memory_);
+	ReadMetaData(memory_);
+
+	// without the streams offsets and the moved ambiguous symbols the whole block
+	// needs to be decoded, the same applies to color space data where sequences
+	// are processed along with quality
+	//
+	if ((chunkHeader.flags & FLAG_AMBIGUOUS_SYMBOLS) == 0 || datasetType.colorSpace)
+	{
+		memory_.SetPosition(blockPos);
+		ReadRecords(memory_, chunk_);
+		PostprocessRecords(fq::FastqChecksum::CALC_NONE);
+
+		// compact the records in place -- the output fields always precede
+		// their source locations
+		//
+		uchar* chunkBegin = chunk_.data.Pointer();
+		uint64 bufPos = 0;
+		for (uint32 i = 0; i < chunkHeader.recordsCount; ++i)
+		{
+			FastqRecord& rec = records[i];
+			ASSERT(rec.title >= chunkBegin + bufPos);
+
+			if (withTitles)
+			{
+				std::copy(rec.title, rec.title + rec.titleLen, chunkBegin + bufPos);
+				rec.title = chunkBegin + bufPos;
+				rec.title[0] = '>';
+				bufPos += rec.titleLen;
+				chunkBegin[bufPos++] = '\n';
+			}
+
+			std::copy(rec.sequence, rec.sequence + rec.sequenceLen, chunkBegin + bufPos);
+			rec.sequence = chunkBegin + bufPos;
+			bufPos += rec.sequenceLen;
+			chunkBegin[bufPos++] = '\n';
+		}
+		chunk_.size = bufPos;
+		return;
+	}
+
+	CONTROL_CHECK_R(memory_);
+	ReadLengths(memory_);
+
+	if (withTitles)
+	{
+		// the output layout is denser than FASTQ, so the original chunk size
+		// is a safe upper bound
+		//
+		const uint64 maxSize = chunkHeader.chunkSize + 1;
+		if (chunk_.data.Size() < maxSize)
+			chunk_.data.Extend(maxSize + MEM_EXTENSION_FACTOR(maxSize));
+
+		SeekStream(memory_, blockPos, ChunkHeader::TagStreamOffset);
+		chunk_.size = ReadTags(memory_, chunk_, OutputFormat::Fasta);
+	}
+	else
+	{
+		// prepare the output: each sequence followed by the new line
+		//
+		uint64 outSize = 0;
+		for (uint32 i = 0; i < chunkHeader.recordsCount; ++i)
+			outSize += records[i].qualityLen + 1;
+
+		if (chunk_.data.Size() < outSize)
+			chunk_.data.Extend(outSize + MEM_EXTENSION_FACTOR(outSize));
+
+		uchar* chunkBegin = chunk_.data.Pointer();
+		uint64 bufPos = 0;
+		for (uint32 i = 0; i < chunkHeader.recordsCount; ++i)
+		{
+			FastqRecord& rec = records[i];
+			rec.sequence = chunkBegin + bufPos;
+			bufPos += rec.qualityLen;
+			chunkBegin[bufPos++] = '\n';
+		}
+		chunk_.size = bufPos;
+	}
+
+	// skip the quality stream
+	//
+	SeekStream(memory_, blockPos, ChunkHeader::AmbiguousStreamOffset);
+	ReadAmbiguousSymbols(memory_);
+
+	SeekStream(memory_, blockPos, ChunkHeader::DnaStreamOffset);
 	ReadDNA(memory_);
 
+	RestoreAmbiguousSymbols();
+
+	recordsProcessor->ProcessSequencesBackward(records.data(), chunkHeader.recordsCount);
+
+	// the titles can be changed only after decoding as the tag decoder
+	// refers to the previous ones
+	//
+	if (withTitles)
+	{
+		for (uint32 i = 0; i < chunkHeader.recordsCount; ++i)
+			records[i].title[0] = '>';
+	}
+}
+
+
+void BlockCompressor::ReadTagRecords(BitMemoryReader &memory_, FastqDataChunk &chunk_)
+{
+	const uint64 blockPos = memory_.Position();
+
 	CONTROL_CHECK_R(memory_);
+	ReadMetaData(memory_);
+
+	const uint64 maxSize = chunkHeader.chunkSize + 1;
+	if (chunk_.data.Size() < maxSize)
+		chunk_.data.Extend(maxSize + MEM_EXTENSION_FACTOR(maxSize));
+
+	// records lengths are not needed when stored separately, otherwise
+	// they are interleaved with the tags -- in both cases the quality
+	// and dna streams are not touched
+	//
+	SeekStream(memory_, blockPos, ChunkHeader::TagStreamOffset);
+	ReadTags(memory_, chunk_, OutputFormat::TagsOnly);
+
+	// strip the leading '@' -- as above, only after all the tags are decoded
+	//
+	uchar* chunkBegin = chunk_.data.Pointer();
+	uint64 bufPos = 0;
+	for (uint32 i = 0; i < chunkHeader.recordsCount; ++i)
+	{
+		FastqRecord& rec = records[i];
+		ASSERT(rec.titleLen > 0);
+
+		std::copy(rec.title + 1, rec.title + rec.titleLen, chunkBegin + bufPos);
+		rec.title = chunkBegin + bufPos;
+		rec.titleLen--;
+		bufPos += rec.titleLen;
+		chunkBegin[bufPos++] = '\n';
+	}
+	chunk_.size = bufPos;
+}
+
+
+void BlockCompressor::RestoreAmbiguousSymbols()
+{
+	// put the ambiguous symbols back at their positions, moving the
+	// decoded DNA symbols backwards
+	//
+	const AmbiguousSymbol* amb = ambiguousSymbols.data();
+	for (uint32 i = 0; i < chunkHeader.recordsCount; ++i)
+	{
+		FastqRecord& rec = records[i];
+		uint32 ambCount = rec.qualityLen - rec.sequenceLen;
+		if (ambCount > 0)
+		{
+			int32 seqi = rec.sequenceLen - 1;
+			int32 ambi = ambCount - 1;
+			for (int32 j = rec.qualityLen - 1; j >= 0; --j)
+			{
+				if (ambi >= 0 && amb[ambi].position == j)
+					rec.sequence[j] = amb[ambi--].symbol;
+				else
+					rec.sequence[j] = rec.sequence[seqi--];
+			}
+			ASSERT(seqi == -1 && ambi == -1);
+			amb += ambCount;
+		}
+		rec.sequenceLen = rec.qualityLen;
+	}
 }
 
 
@@ -305,7 +806,8 @@ void BlockCompressor::ReadMetaData(BitMemoryReader &memory_)
 	chunkHeader.flags = memory_.GetWord();
 	ASSERT(chunkHeader.flags < 1 << 8);
 
-	chunkHeader.chunkSize = memory_.GetWord();
+	const bool largeSizes = (chunkHeader.flags & FLAG_LARGE_SIZES) != 0;
+	chunkHeader.chunkSize = largeSizes ? memory_.GetDWord() : memory_.GetWord();
 
 	// setup records
 	//
@@ -352,7 +854,15 @@ void BlockCompressor::ReadMetaData(BitMemoryReader &memory_)
 		}
 	}
 
+	if ((chunkHeader.flags & FLAG_STREAM_OFFSETS) != 0)
+	{
+		for (uint32 i = 0; i < ChunkHeader::StreamOffsetsCount; ++i)
+			chunkHeader.streamOffsets[i] = largeSizes ? memory_.GetDWord() : memory_.GetWord();
+	}
+
 	memory_.FlushInputWordBuffer();
+
+	SelectEntropyCoders();
 }
 
 
@@ -405,7 +915,12 @@ void BlockCompressor::StoreMetaData(BitMemoryWriter &memory_)
 	memory_.PutWord(chunkHeader.recordsCount);
 	memory_.PutWord(chunkHeader.maxQuaLength);
 	memory_.PutWord(chunkHeader.flags);
-	memory_.PutWord(chunkHeader.chunkSize);
+
+	const bool largeSizes = (chunkHeader.flags & FLAG_LARGE_SIZES) != 0;
+	if (largeSizes)
+		memory_.PutDWord(chunkHeader.chunkSize);
+	else
+		memory_.PutWord(chunkHeader.chunkSize);
 
 	if ((chunkHeader.flags & FLAG_VARIABLE_LENGTH) != 0)
 	{
@@ -439,10 +954,135 @@ void BlockCompressor::StoreMetaData(BitMemoryWriter &memory_)
 		}
 	}
 
+	if ((chunkHeader.flags & FLAG_STREAM_OFFSETS) != 0)
+	{
+		for (uint32 i = 0; i < ChunkHeader::StreamOffsetsCount; ++i)
+		{
+			if (largeSizes)
+				memory_.PutDWord(chunkHeader.streamOffsets[i]);
+			else
+				memory_.PutWord(chunkHeader.streamOffsets[i]);
+		}
+	}
+
+	memory_.FlushPartialWordBuffer();
+}
+
+
+void BlockCompressor::StoreLengths(BitMemoryWriter &memory_)
+{
+	const uint32 lenBits = core::bit_length(chunkHeader.maxQuaLength - chunkHeader.minQuaLength);
+	if (lenBits == 0)
+		return;
+
+	for (uint32 i = 0; i < chunkHeader.recordsCount; ++i)
+		memory_.PutBits(records[i].qualityLen - chunkHeader.minQuaLength, lenBits);
+
+	memory_.FlushPartialWordBuffer();
+}
+
+
+void BlockCompressor::ReadLengths(BitMemoryReader &memory_)
+{
+	const uint32 lenBits = core::bit_length(chunkHeader.maxQuaLength - chunkHeader.minQuaLength);
+	if (lenBits == 0)
+	{
+		for (uint32 i = 0; i < chunkHeader.recordsCount; ++i)
+			records[i].qualityLen = chunkHeader.maxQuaLength;
+		return;
+	}
+
+	for (uint32 i = 0; i < chunkHeader.recordsCount; ++i)
+		records[i].qualityLen = memory_.GetBits(lenBits) + chunkHeader.minQuaLength;
+
+	memory_.FlushInputWordBuffer();
+}
+
+
+void BlockCompressor::StoreAmbiguousSymbols(BitMemoryWriter &memory_)
+{
+	// for every record: unary coded count and list of the DNA symbols
+	// moved to the quality stream, required to decode DNA stream alone --
+	// a single bit marks blocks without any
+	//
+	const uint32 posBits = core::bit_length(chunkHeader.maxQuaLength);
+
+	uint64 movedCount = 0;
+	for (uint32 i = 0; i < chunkHeader.recordsCount; ++i)
+		movedCount += records[i].qualityLen - records[i].sequenceLen;
+
+	memory_.PutBit(movedCount != 0);
+
+	for (uint32 i = 0; i < chunkHeader.recordsCount && movedCount != 0; ++i)
+	{
+		const FastqRecord& rec = records[i];
+
+		ambiguousSymbols.clear();
+		for (uint32 j = 0; j < rec.qualityLen; ++j)
+		{
+			AmbiguousSymbol amb;
+			if (recordsProcessor->IsSymbolMoved(rec.quality[j], amb.symbol))
+			{
+				amb.position = j;
+				ambiguousSymbols.push_back(amb);
+			}
+		}
+
+		ASSERT(ambiguousSymbols.size() == (uint32)(rec.qualityLen - rec.sequenceLen));
+		for (uint32 j = 0; j < ambiguousSymbols.size(); ++j)
+			memory_.PutBit(1);
+		memory_.PutBit(0);
+
+		for (uint32 j = 0; j < ambiguousSymbols.size(); ++j)
+		{
+			const AmbiguousSymbol& amb = ambiguousSymbols[j];
+			ASSERT(amb.symbol < (1 << AmbiguousSymbolBits));
+
+			memory_.PutBits(amb.position, posBits);
+			memory_.PutBit(amb.symbol != DefaultAmbiguousSymbol);
+			if (amb.symbol != DefaultAmbiguousSymbol)
+				memory_.PutBits(amb.symbol, AmbiguousSymbolBits);
+		}
+	}
+
 	memory_.FlushPartialWordBuffer();
 }
 
 
+void BlockCompressor::ReadAmbiguousSymbols(BitMemoryReader &memory_)
+{
+	const uint32 posBits = core::bit_length(chunkHeader.maxQuaLength);
+
+	const bool anyMoved = memory_.GetBit() != 0;
+
+	ambiguousSymbols.clear();
+	for (uint32 i = 0; i < chunkHeader.recordsCount; ++i)
+	{
+		FastqRecord& rec = records[i];
+		rec.sequenceLen = rec.qualityLen;
+
+		uint32 count = 0;
+		while (anyMoved && memory_.GetBit() != 0)
+			count++;
+
+		for (uint32 j = 0; j < count; ++j)
+		{
+			AmbiguousSymbol amb;
+			amb.position = memory_.GetBits(posBits);
+			amb.symbol = DefaultAmbiguousSymbol;
+			if (memory_.GetBit() != 0)
+				amb.symbol = memory_.GetBits(AmbiguousSymbolBits);
+			ambiguousSymbols.push_back(amb);
+		}
+
+		ASSERT(count <= rec.qualityLen);
+		rec.sequenceLen -= count;
+	}
+
+	memory_.FlushInputWordBuffer();
+}
+
+
 void BlockCompressor::StoreDNA(BitMemoryWriter &memory_)
 {
 	dnaModeler->Encode(memory_, records.data(), chunkHeader.recordsCount);
@@ -455,6 +1095,20 @@ void BlockCompressor::StoreQuality(BitMemoryWriter &memory_)
 }
 
 
+void BlockCompressor::StoreDnaStream()
+{
+	dnaMemory->SetPosition(0);
+	StoreDNA(*dnaMemory);
+}
+
+
+void BlockCompressor::StoreQualityStream()
+{
+	qualityMemory->SetPosition(0);
+	StoreQuality(*qualityMemory);
+}
+
+
 void BlockCompressor::StoreTags(BitMemoryWriter &memory_)
 {
 	ITagEncoder* encoder = NULL;
@@ -478,7 +1132,7 @@ void BlockCompressor::StoreTags(BitMemoryWriter &memory_)
 
 		// save other meta info
 		//
-		if (isVariableLen)
+		if (isVariableLen && (chunkHeader.flags & FLAG_STREAM_OFFSETS) == 0)
 		{
 			memory_.PutBits(rec.qualityLen - chunkHeader.minQuaLength, lenBits);
 		}
@@ -494,14 +1148,22 @@ void BlockCompressor::ReadDNA(BitMemoryReader &memory_)
 }
 
 
+void BlockCompressor::ReadDnaStream()
+{
+	dnaModeler->Decode(*dnaReader, dnaRecords.data(), chunkHeader.recordsCount);
+}
+
+
 void BlockCompressor::ReadQuality(BitMemoryReader &memory_)
 {
 	qualityModeler->Decode(memory_, records.data(), chunkHeader.recordsCount);
 }
 
 
-void BlockCompressor::ReadTags(BitMemoryReader &memory_, FastqDataChunk& fqChunk_)
+uint64 BlockCompressor::ReadTags(BitMemoryReader &memory_, FastqDataChunk& fqChunk_, OutputFormat::FormatEnum format_)
 {
+	ASSERT(format_ != OutputFormat::SequencesOnly);
+
 	ITagDecoder* decoder = NULL;
 
 	if ((chunkHeader.flags & FLAG_MIXED_FIELD_FORMATTING) != 0)
@@ -510,7 +1172,7 @@ void BlockCompressor::ReadTags(BitMemoryReader &memory_, FastqDataChunk& fqChunk
 		decoder = tagModeler.SelectDecoder(TagModeler::TagTokenizeHuffman);
 
 	uchar* chunkBegin = fqChunk_.data.Pointer();
-	uint32 bufPos = 0;
+	uint64 bufPos = 0;
 
 	const uint32 lenBits = core::bit_length(chunkHeader.maxQuaLength - chunkHeader.minQuaLength);
 	const bool isVariableLen =  lenBits > 0;
@@ -534,10 +1196,17 @@ void BlockCompressor::ReadTags(BitMemoryReader &memory_, FastqDataChunk& fqChunk
 		// code below should be logically split, but to avoid another loop
 		// throught the records we are doing it here
 
-		if (isVariableLen)
-			curRec.qualityLen = memory_.GetBits(lenBits) + chunkHeader.minQuaLength;
-		else
-			curRec.qualityLen = chunkHeader.maxQuaLength;
+		// lengths are already read when stored separately
+		if ((chunkHeader.flags & FLAG_STREAM_OFFSETS) == 0)
+		{
+			if (isVariableLen)
+				curRec.qualityLen = memory_.GetBits(lenBits) + chunkHeader.minQuaLength;
+			else
+				curRec.qualityLen = chunkHeader.maxQuaLength;
+		}
+
+		if (format_ == OutputFormat::TagsOnly)
+			continue;
 
 		curRec.sequenceLen = curRec.qualityLen;
 
@@ -550,6 +1219,10 @@ void BlockCompressor::ReadTags(BitMemoryReader &memory_, FastqDataChunk& fqChunk
 		}
 		chunkBegin[bufPos++] = '\n';
 
+		// no space is reserved for the quality when not decoded
+		if (format_ == OutputFormat::Fasta)
+			continue;
+
 		chunkBegin[bufPos++] = '+';
 		if (datasetType.plusRepetition)
 		{
@@ -570,6 +1243,8 @@ void BlockCompressor::ReadTags(BitMemoryReader &memory_, FastqDataChunk& fqChunk
 	}
 
 	decoder->FinishDecoding(memory_);
+
+	return bufPos;
 }
 
 
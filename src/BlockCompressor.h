@@ -13,6 +13,7 @@
 #include "../include/dsrc/Globals.h"
 
 #include <vector>
+#include <algorithm>
 
 #include "Common.h"
 #include "Fastq.h"
@@ -21,6 +22,7 @@
 #include "QualityModelerProxy.h"
 #include "TagModeler.h"
 #include "Crc32.h"
+#include "StreamThread.h"
 
 #include "huffman.h"
 
@@ -32,6 +34,15 @@ namespace comp
 
 struct ChunkHeader
 {
+	enum StreamOffsetsEnum
+	{
+		TagStreamOffset = 0,
+		AmbiguousStreamOffset,
+		QualityStreamOffset,
+		DnaStreamOffset,
+		StreamOffsetsCount
+	};
+
 	uint64 recordsCount;
 	uint64 chunkSize;
 	uint32 flags;
@@ -46,6 +57,8 @@ struct ChunkHeader
 	fq::FastqChecksum checksum;
 	uint32 checksumFlags;
 
+	uint64 streamOffsets[StreamOffsetsCount];		// relative to the block beginning
+
 	ChunkHeader()
 		:	recordsCount(0)
 		,	chunkSize(0)
@@ -56,34 +69,73 @@ struct ChunkHeader
 		,	csSeqBegin(0)
 		,	csQuaBegin(0)
 		,	checksumFlags(fq::FastqChecksum::CALC_NONE)
-	{}
+	{
+		std::fill(streamOffsets, streamOffsets + StreamOffsetsCount, 0);
+	}
+};
+
+
+struct AmbiguousSymbol
+{
+	uint16 position;
+	uchar symbol;
 };
 
 
 class BlockCompressor
 {
 public:
-	BlockCompressor(const fq::FastqDatasetType& type_, const CompressionSettings& settings_);
+	BlockCompressor(const fq::FastqDatasetType& type_, const CompressionSettings& settings_,
+					bool parallelStreams_ = false);
 	virtual ~BlockCompressor();
 	
-	void Store(core::BitMemoryWriter &memory_, fq::StreamsInfo& rawStreamsInfo_, fq::StreamsInfo& compStreamsInfo_, const fq::FastqDataChunk& chunk_);
+	uint64 Store(core::BitMemoryWriter &memory_, fq::StreamsInfo& rawStreamsInfo_, fq::StreamsInfo& compStreamsInfo_, const fq::FastqDataChunk& chunk_);
 	void Read(core::BitMemoryReader &memory_, fq::FastqDataChunk& chunk_);
+	void Read(core::BitMemoryReader &memory_, fq::FastqDataChunk& chunk_, uint64 skipRecords_, uint64 recordsCount_,
+			  OutputFormat::FormatEnum format_ = OutputFormat::Fastq);
+	void ReadSequencesOnly(core::BitMemoryReader &memory_, fq::FastqDataChunk& chunk_);
 	bool VerifyChecksum(core::BitMemoryReader &memory_, fq::FastqDataChunk& chunk_);
 
 	void Reset();
 
+	static uint32 ReadRecordsCount(core::BitMemoryReader &memory_);
+	static uint64 ReadChunkSize(core::BitMemoryReader &memory_);
+
+	// whether the cores left idle by the block-level threads are enough
+	// to encode the streams of every block concurrently
+	//
+	static bool UseParallelStreams(uint32 blockThreadsNum_);
+
+	// memory held by a compressor processing blocks of the given size:
+	// the models tables and the records descriptors
+	//
+	static uint64 EstimateMemorySize(const CompressionSettings& settings_, uint64 blockSize_, bool parallelStreams_);
+
 protected:
 	enum FastqBlockFlags
 	{
 		FLAG_DELTA_CONSTANT			= BIT(0),
 		FLAG_VARIABLE_LENGTH		= BIT(1),
-		FLAG_MIXED_FIELD_FORMATTING	= BIT(2)		// this should be handled by TagModelerProxy*
+		FLAG_MIXED_FIELD_FORMATTING	= BIT(2),		// this should be handled by TagModelerProxy*
+		FLAG_STREAM_OFFSETS			= BIT(3),		// streams offsets table and records lengths stored separately
+		FLAG_LARGE_SIZES			= BIT(4),		// chunk size and streams offsets stored on 64 bits
+		FLAG_RANS_DNA				= BIT(5),		// dna and quality order models coded with rANS
+		FLAG_RANS_QUALITY			= BIT(6),		// instead of the range coder
+		FLAG_AMBIGUOUS_SYMBOLS		= BIT(7)		// ambiguous symbols moved to quality stream stored
+													// after dna, required to decode dna alone
 	};
 
 	const fq::FastqDatasetType datasetType;
 	const CompressionSettings compSettings;
 
+	static const uint32 StreamThreadsNum = 3;			// tags, quality and dna
+	static const uint32 EstimatedRecordSize = 64;		// short reads, errs on the side of more records
+	static const uint32 AmbiguousSymbolBits = 5;
+	static const uchar DefaultAmbiguousSymbol = 4;		// 'N'
+	static const uint32 MaxAmbiguousStreamRatio = 256;	// moved symbols kept below 1/256 of the block
+
 	std::vector<fq::FastqRecord> records;
+	std::vector<AmbiguousSymbol> ambiguousSymbols;
 
 	ChunkHeader chunkHeader;
 
@@ -92,6 +144,19 @@ protected:
 	IDnaModelerProxy* dnaModeler;
 	IQualityModeler* qualityModeler;
 
+	// with parallel streams quality and dna are encoded into separate buffers
+	// by helper threads and appended to the block after the tags, when decoding
+	// dna is decoded by a helper thread into a copy of the records -- the helper
+	// threads are started with the first block and reused for the next ones
+	//
+	const bool parallelStreams;
+	core::BitMemoryWriter* qualityMemory;
+	core::BitMemoryWriter* dnaMemory;
+	std::vector<fq::FastqRecord> dnaRecords;
+	core::BitMemoryReader* dnaReader;
+	core::TStreamThread<BlockCompressor>* qualityThread;
+	core::TStreamThread<BlockCompressor>* dnaThread;
+
 	void ParseRecords(const fq::FastqDataChunk& chunk_, fq::StreamsInfo& streamSizes_);
 
 	void PreprocessRecords(uint32 checksumFlags_ = fq::FastqChecksum::CALC_NONE);
@@ -99,22 +164,39 @@ protected:
 
 	void AnalyzeRecords();
 	void AnalyzeMetaData(const DnaStats& dnaStats_, const QualityStats& qStats_, const ColorSpaceStats& csStats_);
+	void SelectEntropyCoders();
 
 	void StoreRecords(core::BitMemoryWriter &memory_, fq::StreamsInfo& streamInfo_);
 	void ReadRecords(core::BitMemoryReader &memory_, fq::FastqDataChunk& chunk_);
+	void ReadStreamsParallel(core::BitMemoryReader &memory_, uint64 blockPos_);
+	void WaitStreamThreads();
+	void SeekStream(core::BitMemoryReader &memory_, uint64 blockPos_, uint32 stream_);
+	void ReadProjectedRecords(core::BitMemoryReader &memory_, fq::FastqDataChunk& chunk_, OutputFormat::FormatEnum format_);
+	void ReadTagRecords(core::BitMemoryReader &memory_, fq::FastqDataChunk& chunk_);
+	void SelectRecords(fq::FastqDataChunk& chunk_, uint64 skipRecords_, uint64 recordsCount_, OutputFormat::FormatEnum format_);
 
 	void StoreMetaData(core::BitMemoryWriter &memory_);
 	void ReadMetaData(core::BitMemoryReader &memory_);
 
 	void AnalyzeTags();
 	void StoreTags(core::BitMemoryWriter &memory_);
-	void ReadTags(core::BitMemoryReader &memory_, fq::FastqDataChunk& chunk_);
+	uint64 ReadTags(core::BitMemoryReader &memory_, fq::FastqDataChunk& chunk_, OutputFormat::FormatEnum format_ = OutputFormat::Fastq);
+
+	void StoreLengths(core::BitMemoryWriter &memory_);
+	void ReadLengths(core::BitMemoryReader &memory_);
+
+	void StoreAmbiguousSymbols(core::BitMemoryWriter &memory_);
+	void ReadAmbiguousSymbols(core::BitMemoryReader &memory_);
+	void RestoreAmbiguousSymbols();
 
 	void StoreDNA(core::BitMemoryWriter &memory_);
 	void StoreQuality(core::BitMemoryWriter &memory_);
+	void StoreDnaStream();
+	void StoreQualityStream();
 
 	void ReadDNA(core::BitMemoryReader &memory_);
 	void ReadQuality(core::BitMemoryReader &memory_);
+	void ReadDnaStream();
 };
 
 } // namespace comp
@@ -24,8 +24,9 @@ namespace wrap
 class BlockCompressorExt : public comp::BlockCompressor
 {
 public:
-	BlockCompressorExt(const fq::FastqDatasetType& type_, const comp::CompressionSettings& settings_)
-		:	comp::BlockCompressor(type_, settings_)
+	BlockCompressorExt(const fq::FastqDatasetType& type_, const comp::CompressionSettings& settings_,
+					   bool parallelStreams_ = false)
+		:	comp::BlockCompressor(type_, settings_, parallelStreams_)
 		,	recordsIdx(0)
 	{
 		fastqChunk.data.Extend(DefaultFastqBufferSize + FastqBufferPadding);
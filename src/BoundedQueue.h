@@ -0,0 +1,271 @@
+/*
+  This file is a part of DSRC software distributed under GNU GPL 2 licence.
+  The homepage of the DSRC project is http://sun.aei.polsl.pl/dsrc
+  
+  Authors: Lucas Roguski and Sebastian Deorowicz
+  
+  Version: 2.00
+*/
+
+#ifndef H_BOUNDEDQUEUE
+#define H_BOUNDEDQUEUE
+
+#include "../include/dsrc/Globals.h"
+
+#ifdef USE_BOOST_THREAD
+#include <boost/thread.hpp>
+#include <boost/atomic.hpp>
+namespace th = boost;
+#else
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+namespace th = std;
+#endif
+
+#if defined(__i386__) || defined(__x86_64__) || defined(_M_IX86) || defined(_M_X64)
+#include <emmintrin.h>
+#define CPU_RELAX() _mm_pause()
+#else
+#define CPU_RELAX()
+#endif
+
+namespace dsrc
+{
+
+namespace core
+{
+
+// Bounded multi-producer multi-consumer ring buffer, every cell carries
+// a sequence number telling whether it is ready for a push or for a pop,
+// so the producers and consumers only contend on their own position counter
+//
+template <class _TDataType>
+class TBoundedQueue
+{
+	typedef _TDataType DataType;
+
+	struct Cell
+	{
+		th::atomic<uint32> sequence;
+		DataType data;
+	};
+
+	static const uint32 CacheLineSize = 64;
+
+	Cell* cells;
+	uint32 mask;
+	char pad0[CacheLineSize];
+	th::atomic<uint32> pushPos;
+	char pad1[CacheLineSize];
+	th::atomic<uint32> popPos;
+	char pad2[CacheLineSize];
+
+	TBoundedQueue(const TBoundedQueue&);
+	TBoundedQueue& operator= (const TBoundedQueue&);
+
+public:
+	TBoundedQueue(uint32 minCapacity_)
+		:	pushPos(0)
+		,	popPos(0)
+	{
+		ASSERT(minCapacity_ > 0);
+
+		uint32 capacity = 2;
+		while (capacity < minCapacity_)
+			capacity <<= 1;
+
+		mask = capacity - 1;
+		cells = new Cell[capacity];
+		for (uint32 i = 0; i < capacity; ++i)
+			cells[i].sequence.store(i, th::memory_order_relaxed);
+	}
+
+	~TBoundedQueue()
+	{
+		delete[] cells;
+	}
+
+	uint32 Capacity() const
+	{
+		return mask + 1;
+	}
+
+	bool IsEmpty() const
+	{
+		return popPos.load(th::memory_order_acquire) == pushPos.load(th::memory_order_acquire);
+	}
+
+	bool TryPush(const DataType& data_)
+	{
+		Cell* cell;
+		uint32 pos = pushPos.load(th::memory_order_relaxed);
+		for ( ;; )
+		{
+			cell = &cells[pos & mask];
+			int32 diff = (int32)(cell->sequence.load(th::memory_order_acquire) - pos);
+
+			if (diff == 0)
+			{
+				if (pushPos.compare_exchange_weak(pos, pos + 1, th::memory_order_relaxed))
+					break;
+			}
+			else if (diff < 0)
+			{
+				return false;
+			}
+			else
+			{
+				pos = pushPos.load(th::memory_order_relaxed);
+			}
+		}
+
+		cell->data = data_;
+		cell->sequence.store(pos + 1, th::memory_order_release);
+		return true;
+	}
+
+	bool TryPop(DataType& data_)
+	{
+		Cell* cell;
+		uint32 pos = popPos.load(th::memory_order_relaxed);
+		for ( ;; )
+		{
+			cell = &cells[pos & mask];
+			int32 diff = (int32)(cell->sequence.load(th::memory_order_acquire) - (pos + 1));
+
+			if (diff == 0)
+			{
+				if (popPos.compare_exchange_weak(pos, pos + 1, th::memory_order_relaxed))
+					break;
+			}
+			else if (diff < 0)
+			{
+				return false;
+			}
+			else
+			{
+				pos = popPos.load(th::memory_order_relaxed);
+			}
+		}
+
+		data_ = cell->data;
+		cell->sequence.store(pos + mask + 1, th::memory_order_release);
+		return true;
+	}
+};
+
+
+// Spin-then-park waiting: a waiter first spins re-checking its condition,
+// then registers with PrepareWait(), checks the condition once more and
+// parks in CommitWait() until a Notify() issued after the registration.
+// Notify() wakes a single waiter for a single item made available, NotifyAll()
+// wakes all of them, both are a fence and a load while nobody is parked
+//
+class EventCount
+{
+	th::atomic<uint32> waitersNum;
+	th::atomic<uint32> epoch;
+
+	const uint32 spinCount;
+	const uint32 maxYieldingNum;
+
+	th::mutex mutex;
+	th::condition_variable condition;
+
+	EventCount(const EventCount&);
+	EventCount& operator= (const EventCount&);
+
+public:
+	static const uint32 SpinCount = 64;
+	static const uint32 YieldCount = 16;
+	static const uint32 MinYieldingNum = 32;
+
+	EventCount()
+		:	waitersNum(0)
+		,	epoch(0)
+		,	spinCount(th::thread::hardware_concurrency() > 1 ? SpinCount : 0)
+		,	maxYieldingNum(th::thread::hardware_concurrency() > MinYieldingNum ? th::thread::hardware_concurrency() : MinYieldingNum)
+	{}
+
+	// returns false when the caller should stop spinning and park, on a single
+	// core busy spinning only delays the thread being waited for, so it yields --
+	// once as many waiters as there are cores (but at least a few) are parked the
+	// rest park without yielding, more threads yielding in turn only starve the
+	// one waited for
+	//
+	bool Spin(uint32& spin_) const
+	{
+		if (spin_ >= spinCount + YieldCount)
+			return false;
+
+		if (spin_ >= spinCount && waitersNum.load(th::memory_order_relaxed) >= maxYieldingNum)
+			return false;
+
+		if (spin_ < spinCount)
+		{
+			for (uint32 i = 0; i < 16; ++i)
+				CPU_RELAX();
+		}
+		else
+		{
+			th::this_thread::yield();
+		}
+		spin_++;
+		return true;
+	}
+
+	uint32 PrepareWait()
+	{
+		waitersNum.fetch_add(1, th::memory_order_seq_cst);
+		th::atomic_thread_fence(th::memory_order_seq_cst);
+		return epoch.load(th::memory_order_acquire);
+	}
+
+	void CancelWait()
+	{
+		waitersNum.fetch_sub(1, th::memory_order_relaxed);
+	}
+
+	void CommitWait(uint32 key_)
+	{
+		th::unique_lock<th::mutex> lock(mutex);
+		while (epoch.load(th::memory_order_relaxed) == key_)
+			condition.wait(lock);
+
+		waitersNum.fetch_sub(1, th::memory_order_relaxed);
+	}
+
+	void Notify()
+	{
+		th::atomic_thread_fence(th::memory_order_seq_cst);
+		if (waitersNum.load(th::memory_order_relaxed) == 0)
+			return;
+
+		{
+			th::lock_guard<th::mutex> lock(mutex);
+			epoch.fetch_add(1, th::memory_order_release);
+		}
+		condition.notify_one();
+	}
+
+	void NotifyAll()
+	{
+		th::atomic_thread_fence(th::memory_order_seq_cst);
+		if (waitersNum.load(th::memory_order_relaxed) == 0)
+			return;
+
+		{
+			th::lock_guard<th::mutex> lock(mutex);
+			epoch.fetch_add(1, th::memory_order_release);
+		}
+		condition.notify_all();
+	}
+};
+
+} // namespace core
+
+} // namespace dsrc
+
+#endif // H_BOUNDEDQUEUE
@@ -112,6 +112,15 @@ struct FastqRecord;
 namespace comp
 {
 
+struct EntropyCoder
+{
+	enum CoderEnum
+	{
+		Range = 0,
+		Rans				// interleaved rANS, faster decoding
+	};
+};
+
 struct CompressionSettings
 {
 	static const uint32 MaxDnaOrder = 9;
@@ -120,11 +129,22 @@ struct CompressionSettings
 	static const uint32 DefaultQualityOrder = 0;
 	static const uint32 DefaultTagPreserveFlags = 0;		// 0 -- keep all
 
+	// streams of the order modes coded with rANS instead of the range coder,
+	// the choice is stored per block, so it is not a part of the archive settings
+	//
+	enum RansStreamsFlags
+	{
+		RANS_NONE		= 0,
+		RANS_DNA		= BIT(0),
+		RANS_QUALITY	= BIT(1)
+	};
+
 	uint32	dnaOrder;
 	uint32	qualityOrder;
 	uint64	tagPreserveFlags;
 	bool	lossy;
 	bool	calculateCrc32;
+	uint32	ransStreams;
 
 	CompressionSettings()
 		:	dnaOrder(0)
@@ -132,6 +152,7 @@ struct CompressionSettings
 		,	tagPreserveFlags(DefaultTagPreserveFlags)
 		,	lossy(false)
 		,	calculateCrc32(false)
+		,	ransStreams(RANS_NONE)
 	{}
 
 	static CompressionSettings Default()
@@ -142,33 +163,64 @@ struct CompressionSettings
 		s.tagPreserveFlags = DefaultTagPreserveFlags;
 		s.lossy = false;
 		s.calculateCrc32 = false;
+		s.ransStreams = RANS_NONE;
 		return s;
 	}
 };
 
+struct OutputFormat
+{
+	enum FormatEnum
+	{
+		Fastq = 0,
+		Fasta,				// titles and sequences
+		TagsOnly,			// read names without the leading '@'
+		SequencesOnly		// one sequence per line
+	};
+};
+
 struct InputParameters
 {
 	static const uint32 DefaultQualityOffset = fq::FastqDatasetType::AutoQualityOffset;
 	static const uint32 DefaultDnaCompressionLevel = 0;
 	static const uint32 DefaultQualityCompressionLevel = 0;
 	static const uint32 DefaultProcessingThreadNum = 2;
+	static const uint32 AutoIoThreadNum = 0;
+	static const uint32 ProcessingThreadsPerIoThread = 8;
+	static const uint32 ProcessingThreadsPerInflateThread = 4;
+	static const uint32 AutoVerifyThreadNum = 0;
+	static const uint32 ProcessingThreadsPerVerifyThread = 2;
 	static const uint64 DefaultTagPreserveFlags = 0;
 	static const uint32 DefaultFastqBufferSizeMB = 8;
+	static const uint32 MaxFastqBufferSizeMB = 8192;
+	static const uint32 NoMemoryLimit = 0;
 
 	static const bool DefaultLossyCompressionMode = false;
 	static const bool DefaultCalculateCrc32 = false;
+	static const uint64 DefaultRecordsEnd = (uint64)-1;
 
 
 	uint32 qualityOffset;
 	uint32 dnaCompressionLevel;
 	uint32 qualityCompressionLevel;
 	uint32 threadNum;
+	uint32 ioThreadNum;			// archive reading threads, by default one per 8 processing threads,
+								// or gzip input inflating threads, by default one per 4
+	uint32 verifyThreadNum;		// blocks verifying threads with CRC32, by default one per 2 processing threads
 	uint64 tagPreserveFlags;
 
 	uint32 fastqBufferSizeMB;
+	uint32 memoryLimitMB;		// target peak memory, the pipeline is scaled down to fit it
+	uint32 ransStreams;			// CompressionSettings::RansStreamsFlags
 	bool lossyCompression;
 	bool calculateCrc32;
 	bool useFastqStdIo;
+	bool streamedArchive;		// write archive without seeking back, e.g. to a pipe
+	bool appendArchive;			// add the records to the existing output archive
+
+	uint64 recordsBegin;		// decompress only records [begin, end)
+	uint64 recordsEnd;
+	OutputFormat::FormatEnum outputFormat;
 
 	std::string inputFilename;
 	std::string outputFilename;
@@ -178,13 +230,27 @@ struct InputParameters
 		,	dnaCompressionLevel(DefaultDnaCompressionLevel)
 		,	qualityCompressionLevel(DefaultQualityCompressionLevel)
 		,	threadNum(DefaultProcessingThreadNum)
+		,	ioThreadNum(AutoIoThreadNum)
+		,	verifyThreadNum(AutoVerifyThreadNum)
 		,	tagPreserveFlags(DefaultTagPreserveFlags)
 		,	fastqBufferSizeMB(DefaultFastqBufferSizeMB)
+		,	memoryLimitMB(NoMemoryLimit)
+		,	ransStreams(CompressionSettings::RANS_NONE)
 		,	lossyCompression(DefaultLossyCompressionMode)
 		,	calculateCrc32(DefaultCalculateCrc32)
 		,	useFastqStdIo(false)
+		,	streamedArchive(false)
+		,	appendArchive(false)
+		,	recordsBegin(0)
+		,	recordsEnd(DefaultRecordsEnd)
+		,	outputFormat(OutputFormat::Fastq)
 	{}
 
+	bool IsRecordsRangeSet() const
+	{
+		return recordsBegin != 0 || recordsEnd != DefaultRecordsEnd;
+	}
+
 	static InputParameters Default()
 	{
 		InputParameters args;
@@ -55,8 +55,8 @@ Configurable::~Configurable()
 
 void Configurable::SetFastqBufferSizeMB(uint64 size_)
 {
-	if (size_ == 0 || size_ > 1024)
-		throw DsrcException("Invalid argument: invalid FASTQ buffer size [1-1024]");
+	if (size_ == 0 || size_ > comp::InputParameters::MaxFastqBufferSizeMB)
+		throw DsrcException("Invalid argument: invalid FASTQ buffer size [1-8192]");
 
 	config->inputParams.fastqBufferSizeMB = size_;
 }
@@ -0,0 +1,168 @@
+/*
+  This file is a part of DSRC software distributed under GNU GPL 2 licence.
+  The homepage of the DSRC project is http://sun.aei.polsl.pl/dsrc
+
+  Authors: Lucas Roguski and Sebastian Deorowicz
+
+  Version: 2.00
+*/
+
+#include "Crc32.h"
+
+#if PCLMUL_CRC32
+
+#include <emmintrin.h>
+#include <wmmintrin.h>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#define PCLMUL_TARGET
+#else
+#include <cpuid.h>
+#define PCLMUL_TARGET __attribute__((target("sse2,pclmul")))
+#endif
+
+#endif
+
+namespace dsrc
+{
+
+namespace core
+{
+
+const bool Crc32Hasher::foldingSupported = Crc32Hasher::DetectFolding();
+
+#if PCLMUL_CRC32
+
+bool Crc32Hasher::DetectFolding()
+{
+	uint32 ecx = 0;
+#if defined(_MSC_VER)
+	int regs[4];
+	__cpuid(regs, 1);
+	ecx = regs[2];
+#else
+	uint32 eax, ebx, edx;
+	if (__get_cpuid(1, &eax, &ebx, &ecx, &edx) == 0)
+		return false;
+#endif
+	return (ecx & (1 << 1)) != 0;			// PCLMULQDQ
+}
+
+// Folding of 4 lanes of 16 bytes, then of a single one, followed by the Barrett
+// reduction, as in "Fast CRC Computation for Generic Polynomials Using PCLMULQDQ
+// Instruction" (Intel, 2009) -- the constants are for the bit-reflected zlib
+// polynomial
+//
+PCLMUL_TARGET
+uint32 Crc32Hasher::FoldCrc(const uchar* str_, uint32 len_, uint32 crc_)
+{
+	ASSERT(len_ >= FoldMinLength && len_ % FoldBlockSize == 0);
+
+	static const uint64 k1k2[2] = { 0x0154442bd4ULL, 0x01c6e41596ULL };
+	static const uint64 k3k4[2] = { 0x01751997d0ULL, 0x00ccaa009eULL };
+	static const uint64 k5k0[2] = { 0x0163cd6124ULL, 0x0000000000ULL };
+	static const uint64 poly[2] = { 0x01db710641ULL, 0x01f7011641ULL };
+
+	__m128i x0, x1, x2, x3, x4, x5, x6, x7, x8;
+
+	x1 = _mm_loadu_si128((const __m128i*)(str_ + 0x00));
+	x2 = _mm_loadu_si128((const __m128i*)(str_ + 0x10));
+	x3 = _mm_loadu_si128((const __m128i*)(str_ + 0x20));
+	x4 = _mm_loadu_si128((const __m128i*)(str_ + 0x30));
+	x1 = _mm_xor_si128(x1, _mm_cvtsi32_si128(crc_));
+
+	str_ += 64;
+	len_ -= 64;
+
+	// fold 64 bytes at once
+	//
+	x0 = _mm_loadu_si128((const __m128i*)k1k2);
+	for ( ; len_ >= 64; str_ += 64, len_ -= 64)
+	{
+		x5 = _mm_clmulepi64_si128(x1, x0, 0x00);
+		x6 = _mm_clmulepi64_si128(x2, x0, 0x00);
+		x7 = _mm_clmulepi64_si128(x3, x0, 0x00);
+		x8 = _mm_clmulepi64_si128(x4, x0, 0x00);
+
+		x1 = _mm_clmulepi64_si128(x1, x0, 0x11);
+		x2 = _mm_clmulepi64_si128(x2, x0, 0x11);
+		x3 = _mm_clmulepi64_si128(x3, x0, 0x11);
+		x4 = _mm_clmulepi64_si128(x4, x0, 0x11);
+
+		x1 = _mm_xor_si128(_mm_xor_si128(x1, x5), _mm_loadu_si128((const __m128i*)(str_ + 0x00)));
+		x2 = _mm_xor_si128(_mm_xor_si128(x2, x6), _mm_loadu_si128((const __m128i*)(str_ + 0x10)));
+		x3 = _mm_xor_si128(_mm_xor_si128(x3, x7), _mm_loadu_si128((const __m128i*)(str_ + 0x20)));
+		x4 = _mm_xor_si128(_mm_xor_si128(x4, x8), _mm_loadu_si128((const __m128i*)(str_ + 0x30)));
+	}
+
+	// fold the 4 lanes into one
+	//
+	x0 = _mm_loadu_si128((const __m128i*)k3k4);
+
+	x5 = _mm_clmulepi64_si128(x1, x0, 0x00);
+	x1 = _mm_clmulepi64_si128(x1, x0, 0x11);
+	x1 = _mm_xor_si128(_mm_xor_si128(x1, x2), x5);
+
+	x5 = _mm_clmulepi64_si128(x1, x0, 0x00);
+	x1 = _mm_clmulepi64_si128(x1, x0, 0x11);
+	x1 = _mm_xor_si128(_mm_xor_si128(x1, x3), x5);
+
+	x5 = _mm_clmulepi64_si128(x1, x0, 0x00);
+	x1 = _mm_clmulepi64_si128(x1, x0, 0x11);
+	x1 = _mm_xor_si128(_mm_xor_si128(x1, x4), x5);
+
+	// fold the remaining 16 bytes blocks
+	//
+	for ( ; len_ >= 16; str_ += 16, len_ -= 16)
+	{
+		x5 = _mm_clmulepi64_si128(x1, x0, 0x00);
+		x1 = _mm_clmulepi64_si128(x1, x0, 0x11);
+		x1 = _mm_xor_si128(_mm_xor_si128(x1, _mm_loadu_si128((const __m128i*)str_)), x5);
+	}
+
+	// fold 128 bits to 64 bits
+	//
+	x2 = _mm_clmulepi64_si128(x1, x0, 0x10);
+	x3 = _mm_setr_epi32(~0, 0, ~0, 0);
+	x1 = _mm_srli_si128(x1, 8);
+	x1 = _mm_xor_si128(x1, x2);
+
+	x0 = _mm_loadl_epi64((const __m128i*)k5k0);
+
+	x2 = _mm_srli_si128(x1, 4);
+	x1 = _mm_and_si128(x1, x3);
+	x1 = _mm_clmulepi64_si128(x1, x0, 0x00);
+	x1 = _mm_xor_si128(x1, x2);
+
+	// Barrett reduction to 32 bits
+	//
+	x0 = _mm_loadu_si128((const __m128i*)poly);
+
+	x2 = _mm_and_si128(x1, x3);
+	x2 = _mm_clmulepi64_si128(x2, x0, 0x10);
+	x2 = _mm_and_si128(x2, x3);
+	x2 = _mm_clmulepi64_si128(x2, x0, 0x00);
+	x1 = _mm_xor_si128(x1, x2);
+
+	return (uint32)_mm_cvtsi128_si32(_mm_srli_si128(x1, 4));
+}
+
+#else
+
+bool Crc32Hasher::DetectFolding()
+{
+	return false;
+}
+
+uint32 Crc32Hasher::FoldCrc(const uchar* , uint32 , uint32 crc_)
+{
+	ASSERT(0);
+	return crc_;
+}
+
+#endif
+
+} // namespace core
+
+} // namespace dsrc
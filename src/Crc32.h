@@ -15,6 +15,12 @@
 #include <vector>
 #include <string>
 
+#if defined(__i386__) || defined(__x86_64__) || defined(_M_IX86) || defined(_M_X64)
+#define PCLMUL_CRC32 1
+#else
+#define PCLMUL_CRC32 0
+#endif
+
 namespace dsrc
 {
 
@@ -23,14 +29,24 @@ namespace core
 
 class Crc32Hasher	// CRC32 LSB
 {
+public:
+	static const uint32 DefaultPolynomial = 0xEDB88320;		// the zlib one
+	static const uint32 DefaultSeed = 0xFFFFFFFF;
+
 private:
+	static const uint32 SliceCount = 8;
+	static const uint32 FoldBlockSize = 16;
+	static const uint32 FoldMinLength = 64;
+
 	uint32 polynomial;
 	uint32 crc;
-	uint32 lookup_table[256];
+	uint32 lookup_table[SliceCount][256];		// [0] is the byte-wise table, [k] advances it by k bytes
+
+	static const bool foldingSupported;
 
 	void FillLookupTable()
 	{
-		lookup_table[0] = 0;
+		lookup_table[0][0] = 0;
 		for (uint32 i = 1; i < 256; ++i)
 		{
 			uint32 h = i;
@@ -45,12 +61,35 @@ private:
 					h >>= 1;
 				}
 			}
-			lookup_table[i] = h;
+			lookup_table[0][i] = h;
+		}
+
+		for (uint32 k = 1; k < SliceCount; ++k)
+		{
+			for (uint32 i = 0; i < 256; ++i)
+			{
+				const uint32 h = lookup_table[k - 1][i];
+				lookup_table[k][i] = (h >> 8) ^ lookup_table[0][h & 0xFF];
+			}
 		}
 	}
 
+	static uint32 LoadWord(const uchar* str_)
+	{
+		return str_[0] | (str_[1] << 8) | (str_[2] << 16) | ((uint32)str_[3] << 24);
+	}
+
+	// checks for the carry-less multiplication support
+	//
+	static bool DetectFolding();
+
+	// folds the multiple of 16 bytes (at least 64) with the carry-less
+	// multiplication, the constants are precomputed for the default polynomial
+	//
+	static uint32 FoldCrc(const uchar* str_, uint32 len_, uint32 crc_);
+
 public:
-	Crc32Hasher(uint32 polynomial_ = 0xEDB88320, uint32 seed_ = 0xFFFFFFFF)
+	Crc32Hasher(uint32 polynomial_ = DefaultPolynomial, uint32 seed_ = DefaultSeed)
 		:	polynomial(polynomial_)
 		,	crc(seed_)
 	{
@@ -59,11 +98,31 @@ public:
 
 	void UpdateCrc(uchar c_)
 	{
-		crc = (crc >> 8) ^ lookup_table[(c_ ^ crc) & 0xFF];
+		crc = (crc >> 8) ^ lookup_table[0][(c_ ^ crc) & 0xFF];
 	}
 
 	void UpdateCrc(const uchar* str_, uint32 len_)
 	{
+		if (len_ >= FoldMinLength && polynomial == DefaultPolynomial && foldingSupported)
+		{
+			const uint32 foldLen = len_ & ~(FoldBlockSize - 1);
+			crc = FoldCrc(str_, foldLen, crc);
+			str_ += foldLen;
+			len_ -= foldLen;
+		}
+
+		// slice-by-8: 8 bytes with independent lookups per step
+		//
+		for ( ; len_ >= SliceCount; str_ += SliceCount, len_ -= SliceCount)
+		{
+			const uint32 lo = LoadWord(str_) ^ crc;
+			const uint32 hi = LoadWord(str_ + 4);
+			crc = lookup_table[7][lo & 0xFF] ^ lookup_table[6][(lo >> 8) & 0xFF]
+				^ lookup_table[5][(lo >> 16) & 0xFF] ^ lookup_table[4][lo >> 24]
+				^ lookup_table[3][hi & 0xFF] ^ lookup_table[2][(hi >> 8) & 0xFF]
+				^ lookup_table[1][(hi >> 16) & 0xFF] ^ lookup_table[0][hi >> 24];
+		}
+
 		for (uint32 i = 0; i < len_; ++i)
 		{
 			UpdateCrc(str_[i]);
@@ -75,7 +134,7 @@ public:
 		return crc ^ 0xFFFFFFFF;
 	}
 
-	void Reset(uint32 polynomial_ = 0xEDB88320, uint32 seed_ = 0xFFFFFFFF)
+	void Reset(uint32 polynomial_ = DefaultPolynomial, uint32 seed_ = DefaultSeed)
 	{
 		if (polynomial != polynomial_)
 		{
@@ -90,10 +149,7 @@ public:
 		ASSERT(arr_ != NULL);
 
 		Reset();
-		for (uint32 i = 0; i < len_; ++i)
-		{
-			UpdateCrc(arr_[i]);
-		}
+		UpdateCrc(arr_, len_);
 		return GetHash();
 	}
 
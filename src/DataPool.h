@@ -14,15 +14,7 @@
 
 #include <vector>
 
-#ifdef USE_BOOST_THREAD
-#include <boost/thread.hpp>
-namespace th = boost;
-#else
-#include <thread>
-#include <mutex>
-#include <condition_variable>
-namespace th = std;
-#endif
+#include "BoundedQueue.h"
 
 namespace dsrc
 {
@@ -37,74 +29,97 @@ class TDataPool
 	typedef std::vector<DataType*> part_pool;
 
 	const uint32 maxPartNum;
-	const uint32 bufferPartSize;
-	uint32 partNum;
+	const uint64 bufferPartSize;
 
-	part_pool availablePartsPool;
+	TBoundedQueue<DataType*> availablePartsPool;
 	part_pool allocatedPartsPool;
+	th::atomic<uint32> allocatedPartNum;
 
-	th::mutex mutex;
-	th::condition_variable partsAvailableCondition;
+	EventCount partsAvailableEvent;
 
 public:
 	static const uint32 DefaultMaxPartNum = 32;
-	static const uint32 DefaultBufferPartSize = 1 << 22;
+	static const uint64 DefaultBufferPartSize = 1 << 22;
 
-	TDataPool(uint32 maxPartNum_ = DefaultMaxPartNum, uint32 bufferPartSize_ = DefaultBufferPartSize)
+	TDataPool(uint32 maxPartNum_ = DefaultMaxPartNum, uint64 bufferPartSize_ = DefaultBufferPartSize)
 		:	maxPartNum(maxPartNum_)
 		,	bufferPartSize(bufferPartSize_)
-		,	partNum(0)
+		,	availablePartsPool(maxPartNum_)
+		,	allocatedPartNum(0)
 	{
-		availablePartsPool.resize(maxPartNum);
-		allocatedPartsPool.reserve(maxPartNum);
+		// parts are allocated on their first acquire, empty slots stand for
+		// the parts not allocated yet
+		//
+		allocatedPartsPool.resize(maxPartNum, NULL);
+		for (uint32 i = 0; i < maxPartNum; ++i)
+			availablePartsPool.TryPush(NULL);
 	}
 
 	~TDataPool()
 	{
-		for (typename part_pool::iterator i = allocatedPartsPool.begin(); i != allocatedPartsPool.end(); ++i)
+		const uint32 partNum = allocatedPartNum.load();
+		for (uint32 i = 0; i < partNum; ++i)
 		{
-			ASSERT(*i != NULL);
-			delete *i;
+			ASSERT(allocatedPartsPool[i] != NULL);
+			delete allocatedPartsPool[i];
 		}
 	}
 
-	void Acquire(DataType* &part_)
+	uint32 MaxPartNum() const
 	{
-		th::unique_lock<th::mutex> lock(mutex);
+		return maxPartNum;
+	}
 
-		while (partNum >= maxPartNum)
-			partsAvailableCondition.wait(lock);
+	uint64 BufferPartSize() const
+	{
+		return bufferPartSize;
+	}
 
-		ASSERT(availablePartsPool.size() > 0);
+	void Acquire(DataType* &part_)
+	{
+		DataType* pp = NULL;
+
+		uint32 spin = 0;
+		while (!availablePartsPool.TryPop(pp))
+		{
+			if (partsAvailableEvent.Spin(spin))
+				continue;
+
+			uint32 key = partsAvailableEvent.PrepareWait();
+			if (availablePartsPool.TryPop(pp))
+			{
+				partsAvailableEvent.CancelWait();
+				break;
+			}
+			partsAvailableEvent.CommitWait(key);
+		}
 
-		DataType*& pp = availablePartsPool.back();
-		availablePartsPool.pop_back();
 		if (pp == NULL)
 		{
 			pp = new DataType(bufferPartSize);
-			allocatedPartsPool.push_back(pp);
+
+			const uint32 partId = allocatedPartNum.fetch_add(1);
+			ASSERT(partId < maxPartNum);
+			allocatedPartsPool[partId] = pp;
 		}
 		else
 		{
 			pp->Reset();
 		}
 
-		partNum++;
 		part_ = pp;
 	}
 
 	void Release(const DataType* part_)
 	{
-		th::lock_guard<th::mutex> lock(mutex);
-
 		ASSERT(part_ != NULL);
-		ASSERT(partNum != 0 && partNum <= maxPartNum);
-		ASSERT(std::find(allocatedPartsPool.begin(), allocatedPartsPool.end(), part_) != allocatedPartsPool.end());
 
-		availablePartsPool.push_back((DataType*)part_);
-		partNum--;
+		// the ring holds all the parts, so it is never full here
+		//
+		bool pushed = availablePartsPool.TryPush((DataType*)part_);
+		ASSERT(pushed);
 
-		partsAvailableCondition.notify_one();
+		partsAvailableEvent.Notify();
 	}
 };
 
@@ -12,16 +12,9 @@
 
 #include "../include/dsrc/Globals.h"
 
-#include <queue>
+#include <utility>
 
-#ifdef USE_BOOST_THREAD
-#include <boost/thread.hpp>
-namespace th = boost;
-#else
-#include <mutex>
-#include <condition_variable>
-namespace th = std;
-#endif
+#include "BoundedQueue.h"
 
 namespace dsrc
 {
@@ -33,18 +26,15 @@ template <class _TDataType>
 class TDataQueue
 {
 	typedef _TDataType DataType;
-	typedef std::queue<std::pair<int64, DataType*> > part_queue;
+	typedef std::pair<int64, DataType*> part_entry;
 
 	const uint32 threadNum;
 	const uint32 maxPartNum;
-	uint64 completedThreadMask;
-	uint32 partNum;
-	uint64 currentThreadMask;
-	part_queue parts;
+	th::atomic<uint32> completedThreadNum;
+	TBoundedQueue<part_entry> parts;
 
-	th::mutex mutex;
-	th::condition_variable queueFullCondition;
-	th::condition_variable queueEmptyCondition;
+	EventCount queueFullEvent;
+	EventCount queueEmptyEvent;
 
 public:
 	static const uint32 DefaultMaxPartNum = 64;
@@ -53,14 +43,12 @@ public:
 	TDataQueue(uint32 maxPartNum_ = DefaultMaxPartNum, uint32 threadNum_ = 1)
 		:	threadNum(threadNum_)
 		,	maxPartNum(maxPartNum_)
-		,	partNum(0)
-		,	currentThreadMask(0)
+		,	completedThreadNum(0)
+		,	parts(maxPartNum_ + 1)
 	{
 		ASSERT(maxPartNum_ > 0);
 		ASSERT(threadNum_ >= 1);
-		ASSERT(threadNum_ < 64);
-
-		completedThreadMask = ((uint64)1 << threadNum) - 1;
+		ASSERT(threadNum_ <= DefaultMaxThreadtNum);
 	}
 
 	~TDataQueue()
@@ -68,66 +56,88 @@ public:
 
 	bool IsEmpty()
 	{
-		return parts.empty();
+		return parts.IsEmpty();
 	}
 
 	bool IsCompleted()
 	{
-		return parts.empty() && currentThreadMask == completedThreadMask;
+		return parts.IsEmpty() && completedThreadNum.load(th::memory_order_acquire) == threadNum;
 	}
 
 	void SetCompleted()
 	{
-		th::lock_guard<th::mutex> lock(mutex);
-
-		ASSERT(currentThreadMask != completedThreadMask);
-		currentThreadMask = (currentThreadMask << 1) | 1;
+		ASSERT(completedThreadNum.load() != threadNum);
+		completedThreadNum.fetch_add(1, th::memory_order_release);
 
-		queueEmptyCondition.notify_all();
+		queueEmptyEvent.NotifyAll();
 	}
 
 	void Push(int64 partId_, const DataType* part_)
 	{
-		th::unique_lock<th::mutex> lock(mutex);
+		part_entry entry = std::make_pair(partId_, (DataType*)part_);
 
-		while (partNum > maxPartNum)
-			queueFullCondition.wait(lock);
-
-		parts.push(std::make_pair(partId_, (DataType*)part_));
-		partNum++;
+		uint32 spin = 0;
+		while (!parts.TryPush(entry))
+		{
+			if (queueFullEvent.Spin(spin))
+				continue;
+
+			uint32 key = queueFullEvent.PrepareWait();
+			if (parts.TryPush(entry))
+			{
+				queueFullEvent.CancelWait();
+				break;
+			}
+			queueFullEvent.CommitWait(key);
+		}
 
-		queueEmptyCondition.notify_one();
+		queueEmptyEvent.Notify();
 	}
 
 	bool Pop(int64 &partId_, DataType* &part_)
 	{
-		th::unique_lock<th::mutex> lock(mutex);
-
-		while ((parts.size() == 0) && currentThreadMask != completedThreadMask)
-			queueEmptyCondition.wait(lock);
+		part_entry entry;
 
-		if (parts.size() != 0)
+		uint32 spin = 0;
+		while (!parts.TryPop(entry))
 		{
-			partId_ = parts.front().first;
-			part_ = parts.front().second;
-			partNum--;
-			parts.pop();
-			queueFullCondition.notify_one();
-			return true;
+			if (completedThreadNum.load(th::memory_order_acquire) == threadNum)
+			{
+				// the producers push all their parts before completing, so
+				// only the parts already in the ring are left
+				//
+				if (parts.TryPop(entry))
+					break;
+
+				ASSERT(parts.IsEmpty());
+				return false;
+			}
+
+			if (queueEmptyEvent.Spin(spin))
+				continue;
+
+			uint32 key = queueEmptyEvent.PrepareWait();
+			if (!parts.IsEmpty() || completedThreadNum.load(th::memory_order_acquire) == threadNum)
+			{
+				queueEmptyEvent.CancelWait();
+				continue;
+			}
+			queueEmptyEvent.CommitWait(key);
 		}
 
-		// assure this is impossible
-		ASSERT(currentThreadMask == completedThreadMask);
-		ASSERT(parts.size() == 0);
-		return false;
+		partId_ = entry.first;
+		part_ = entry.second;
+
+		queueFullEvent.Notify();
+		return true;
 	}
 
 	void Reset()
 	{
-		ASSERT(currentThreadMask == completedThreadMask);
+		ASSERT(completedThreadNum.load() == threadNum);
+		ASSERT(parts.IsEmpty());
 
-		partNum = 0;
-		currentThreadMask = 0;
+		completedThreadNum.store(0);
 	}
 };
 
@@ -27,6 +27,11 @@ public:
 
 	virtual void ProcessStats(const DnaStats& stats_) = 0;
 
+	// selects the coder of the adaptive order models, the other ones ignore it
+	//
+	virtual void SetEntropyCoder(EntropyCoder::CoderEnum ) {}
+
+
 	virtual void Encode(core::BitMemoryWriter& writer_, const fq::FastqRecord* records_, uint32 recordsCount_) = 0;
 	virtual void Decode(core::BitMemoryReader& reader_, fq::FastqRecord* records_, uint32 recordsCount_) = 0;
 };
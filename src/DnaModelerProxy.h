@@ -32,8 +32,14 @@ public:
 	IDnaModelerProxy()
 		:	modeler(NULL)
 		,	currentSchemeId(SchemeNone)
+		,	entropyCoder(EntropyCoder::Range)
 	{}
 
+	void SetEntropyCoder(EntropyCoder::CoderEnum coder_)
+	{
+		entropyCoder = coder_;
+	}
+
 	void ProcessStats(const DnaStats& stats_)
 	{
 		ASSERT(stats_.symbolCount < MaxSymbolCount);
@@ -56,6 +62,7 @@ public:
 
 		modeler = SelectModeler(currentSchemeId);
 		ASSERT(modeler != NULL);
+		modeler->SetEntropyCoder(entropyCoder);
 		modeler->Encode(writer_, records_, recordsCount_);
 	}
 
@@ -68,6 +75,7 @@ public:
 
 		modeler = SelectModeler(currentSchemeId);
 		ASSERT(modeler != NULL);
+		modeler->SetEntropyCoder(entropyCoder);
 		modeler->Decode(reader_, records_, recordsCount_);
 	}
 
@@ -79,6 +87,7 @@ protected:
 
 	IDnaModeler* modeler;
 	SchemeId currentSchemeId;
+	EntropyCoder::CoderEnum entropyCoder;
 
 	virtual SchemeId SelectSchemeId(const DnaStats& stats_) = 0;
 	virtual IDnaModeler* SelectModeler(SchemeId schemeId_) = 0;
@@ -144,6 +153,27 @@ public:
 			delete modeler8s;
 	}
 
+	// only the 4 symbols modeler is accounted for, the ambiguous symbols are
+	// moved out of the sequences, so the 8 symbols one is rarely created
+	//
+	static uint64 MemorySize(uint32 order_)
+	{
+		switch (order_)
+		{
+			case 1: return TDnaRCOrderModeler<1, 4>::MemorySize();
+			case 2: return TDnaRCOrderModeler<2, 4>::MemorySize();
+			case 3: return TDnaRCOrderModeler<3, 4>::MemorySize();
+			case 4: return TDnaRCOrderModeler<4, 4>::MemorySize();
+			case 5: return TDnaRCOrderModeler<5, 4>::MemorySize();
+			case 6: return TDnaRCOrderModeler<6, 4>::MemorySize();
+			case 7: return TDnaRCOrderModeler<7, 4>::MemorySize();
+			case 8: return TDnaRCOrderModeler<8, 4>::MemorySize();
+			case 9: return TDnaRCOrderModeler<9, 4>::MemorySize();
+		}
+
+		return 0;
+	}
+
 private:
 	static const uint32 MaxSymbolCount = 8;
 	const uint32 order;
@@ -15,6 +15,7 @@
 #include "DnaModeler.h"
 #include "Fastq.h"
 #include "RangeCoder.h"
+#include "RansCoder.h"
 #include "BitMemory.h"
 #include "SymbolCoderRC.h"
 
@@ -34,18 +35,60 @@ public:
 
 	TDnaRCOrderModeler()
 		:	hash(0)
+		,	entropyCoder(EntropyCoder::Range)
 	{}
 
+	static uint64 MemorySize()
+	{
+		return sizeof(TDnaRCOrderModeler) + CoderTable::EntriesSize();
+	}
+
 	void ProcessStats(const DnaStats &stats_)
 	{
 		ASSERT(stats_.symbolCount <= AlphabetSize);
 	}
 
+	void SetEntropyCoder(EntropyCoder::CoderEnum coder_)
+	{
+		entropyCoder = coder_;
+	}
+
 	void Encode(core::BitMemoryWriter& writer_, const fq::FastqRecord* records_, uint32 recordsCount_)
+	{
+		if (entropyCoder == EntropyCoder::Rans)
+			EncodeRecords<RansEncoder>(writer_, records_, recordsCount_);
+		else
+			EncodeRecords<RangeEncoder>(writer_, records_, recordsCount_);
+	}
+
+	void Decode(core::BitMemoryReader& reader_, fq::FastqRecord* records_, uint32 recordsCount_)
+	{
+		if (entropyCoder == EntropyCoder::Rans)
+			DecodeRecords<RansDecoder>(reader_, records_, recordsCount_);
+		else
+			DecodeRecords<RangeDecoder>(reader_, records_, recordsCount_);
+	}
+
+
+private:
+	typedef uint64 HashType;
+	typedef TSymbolCoderRC<AlphabetSize> Coder;
+
+	static const HashType HashMask = (1 << (Order * AlphabetBits)) - 1;
+	static const uint32 ModelCount = 1 << (core::TLog2<AlphabetSize>::Value * Order);
+
+	typedef TContextTable<Coder, ModelCount> CoderTable;
+
+	CoderTable coders;
+	HashType hash;
+	EntropyCoder::CoderEnum entropyCoder;
+
+	template <class _TEncoder>
+	void EncodeRecords(core::BitMemoryWriter& writer_, const fq::FastqRecord* records_, uint32 recordsCount_)
 	{
 		Clear();
 
-		RangeEncoder encoder(writer_);
+		_TEncoder encoder(writer_);
 
 		encoder.Start();
 		for (uint32 i = 0; i < recordsCount_; ++i)
@@ -60,11 +103,12 @@ public:
 		encoder.End();
 	}
 
-	void Decode(core::BitMemoryReader& reader_, fq::FastqRecord* records_, uint32 recordsCount_)
+	template <class _TDecoder>
+	void DecodeRecords(core::BitMemoryReader& reader_, fq::FastqRecord* records_, uint32 recordsCount_)
 	{
 		Clear();
 
-		RangeDecoder decoder(reader_);
+		_TDecoder decoder(reader_);
 
 		decoder.Start();
 		for (uint32 i = 0; i < recordsCount_; ++i)
@@ -79,26 +123,16 @@ public:
 		decoder.End();
 	}
 
-
-private:
-	typedef uint64 HashType;
-	typedef TSymbolCoderRC<AlphabetSize> Coder;
-	typedef typename Coder::StatType CoderStatType;
-
-	static const HashType HashMask = (1 << (Order * AlphabetBits)) - 1;
-	static const uint32 ModelCount = 1 << (core::TLog2<AlphabetSize>::Value * Order);
-
-	Coder coders[ModelCount];
-	HashType hash;
-
-	void EncodeSymbol(RangeEncoder& rc_, uint32 sym_)
+	template <class _TEncoder>
+	void EncodeSymbol(_TEncoder& rc_, uint32 sym_)
 	{
 		coders[GetHash()].EncodeSymbol(rc_, sym_);
 
 		UpdateHash(sym_);
 	}
 
-	uint32 DecodeSymbol(RangeDecoder& rc_)
+	template <class _TDecoder>
+	uint32 DecodeSymbol(_TDecoder& rc_)
 	{
 		uint32 sym = coders[GetHash()].DecodeSymbol(rc_);
 
@@ -113,9 +147,8 @@ private:
 		// clear hash
 		hash = 0;
 
-		// clear stats -- fill context data with initial '1' value
-		CoderStatType* cd = (CoderStatType*)coders;
-		std::fill(cd, cd + ModelCount * AlphabetSize, 1);
+		// clear stats -- the contexts get their initial '1' values on the first use
+		coders.Clear();
 	}
 
 	HashType GetHash()
@@ -36,7 +36,7 @@ struct ArchiveSettings
 		ASSERT(compSettings.dnaOrder <= 3);
 		ASSERT(compSettings.qualityOrder == 0 || (compSettings.lossy && compSettings.qualityOrder <= 2));
 		ASSERT(fastqSettings.qualityOffset == 33 || fastqSettings.qualityOffset == 64);
-		ASSERT(params_.GetFastqBufferSizeMB() > 0 && params_.GetFastqBufferSizeMB() < 1024);
+		ASSERT(params_.GetFastqBufferSizeMB() > 0 && params_.GetFastqBufferSizeMB() <= InputParameters::MaxFastqBufferSizeMB);
 
 		compSettings.dnaOrder = params_.GetDnaCompressionLevel() * 3;
 		compSettings.qualityOrder = params_.GetQualityCompressionLevel() * 3;
@@ -46,7 +46,7 @@ struct ArchiveSettings
 		fastqSettings.plusRepetition = params_.IsPlusRepetition();
 		fastqSettings.colorSpace = params_.IsColorSpace();
 
-		fastqBufferSize = params_.GetFastqBufferSizeMB() << 20UL;
+		fastqBufferSize = (uint64)params_.GetFastqBufferSizeMB() << 20;
 	}
 
 	void ToInputParams(Configurable& params_)
@@ -54,7 +54,7 @@ struct ArchiveSettings
 		ASSERT(compSettings.dnaOrder <= 9);
 		ASSERT(compSettings.qualityOrder == 0 || (compSettings.lossy && compSettings.qualityOrder <= 6));
 		ASSERT(fastqSettings.qualityOffset == 33 || fastqSettings.qualityOffset == 64);
-		ASSERT((fastqBufferSize >> 20UL) > 0 && (fastqBufferSize >> 20UL) < 1024UL);
+		ASSERT((fastqBufferSize >> 20UL) > 0 && (fastqBufferSize >> 20UL) <= InputParameters::MaxFastqBufferSizeMB);
 
 		params_.SetDnaCompressionLevel(compSettings.dnaOrder / 3);
 		params_.SetQualityCompressionLevel(compSettings.qualityOrder / 3);
@@ -93,7 +93,7 @@ DsrcArchive::DsrcArchive()
 	impl = new ArchiveImpl();
 
 	// set default parameters
-	impl->settings.fastqBufferSize = InputParameters::DefaultFastqBufferSizeMB << 20;
+	impl->settings.fastqBufferSize = (uint64)InputParameters::DefaultFastqBufferSizeMB << 20;
 
 	impl->settings.compSettings = CompressionSettings::Default();
 	impl->settings.fastqSettings = fq::FastqDatasetType::Default();
@@ -128,7 +128,8 @@ void DsrcArchive::StartCompress(const std::string& filename_)
 
 	if(impl->compressor == NULL)
 	{
-		impl->compressor = new BlockCompressorExt(impl->settings.fastqSettings, impl->settings.compSettings);
+		impl->compressor = new BlockCompressorExt(impl->settings.fastqSettings, impl->settings.compSettings,
+												  BlockCompressor::UseParallelStreams(1));
 
 		ASSERT(impl->dsrcChunk == NULL);
 		impl->dsrcChunk = new DsrcDataChunk();
@@ -183,7 +184,8 @@ void DsrcArchive::StartDecompress(const std::string& filename_)
 
 	if (impl->compressor == NULL)
 	{
-		impl->compressor = new BlockCompressorExt(impl->settings.fastqSettings, impl->settings.compSettings);
+		impl->compressor = new BlockCompressorExt(impl->settings.fastqSettings, impl->settings.compSettings,
+												  BlockCompressor::UseParallelStreams(1));
 
 		ASSERT(impl->dsrcChunk == NULL);
 		impl->dsrcChunk = new DsrcDataChunk();
@@ -217,6 +219,7 @@ void DsrcArchive::FinishDecompress()
 void DsrcArchive::FlushChunk()
 {
 	core::BitMemoryWriter mem(impl->dsrcChunk->data);
+	impl->dsrcChunk->recordsCount = impl->compressor->ChunkRecordsIdx();
 	impl->compressor->Flush(mem);
 	mem.Flush();
 	impl->dsrcChunk->size = mem.Position();
@@ -10,8 +10,11 @@
 #include "DsrcFile.h"
 #include "DsrcIo.h"
 #include "BitMemory.h"
+#include "BlockCompressor.h"
+#include "AsyncFileStream.h"
 
 #include <cstring>
+#include <algorithm>
 
 namespace dsrc
 {
@@ -21,9 +24,32 @@ namespace comp
 
 using namespace core;
 
+// fields stored in the footer, the blocks depend only on those
+//
+static bool IsSameDatasetType(const fq::FastqDatasetType& a_, const fq::FastqDatasetType& b_)
+{
+	return a_.qualityOffset == b_.qualityOffset
+		&& a_.plusRepetition == b_.plusRepetition
+		&& a_.colorSpace == b_.colorSpace;
+}
+
+static bool IsSameCompressionSettings(const CompressionSettings& a_, const CompressionSettings& b_)
+{
+	return a_.dnaOrder == b_.dnaOrder
+		&& a_.qualityOrder == b_.qualityOrder
+		&& a_.tagPreserveFlags == b_.tagPreserveFlags
+		&& a_.lossy == b_.lossy
+		&& a_.calculateCrc32 == b_.calculateCrc32;
+}
+
 DsrcFileWriter::DsrcFileWriter()
-	:	fileStream(NULL)
+	:	stream(NULL)
 	,	currentBlockId(0)
+	,	position(0)
+	,	streamed(false)
+	,	appending(false)
+	,	originalTailOffset(0)
+	,	originalSize(0)
 {		
 	std::fill((uchar*)&fileHeader, (uchar*)&fileHeader + sizeof(DsrcFileHeader), 0);
 	fileFooter.dummyByte = 0;
@@ -31,38 +57,141 @@ DsrcFileWriter::DsrcFileWriter()
 
 DsrcFileWriter::~DsrcFileWriter()
 {
-	if (fileStream != NULL)
-		delete fileStream;
+	if (stream != NULL)
+		delete stream;
 }
 
-void DsrcFileWriter::StartCompress(const std::string& fileName_)
+void DsrcFileWriter::StartCompress(const std::string& fileName_, bool streamed_)
 {
-	ASSERT(fileStream == NULL);
+	ASSERT(stream == NULL);
 
-	fileStream = new FileStreamWriterExt(fileName_);
+	if (fileName_ == "-")
+	{
+		stream = new StdStreamWriter();
+		streamed_ = true;
+	}
+	else
+	{
+		FileStreamWriterExt* fileStream = new AsyncFileStreamWriter(fileName_, false, true);
+		streamed_ |= !fileStream->IsSeekable();
+		stream = fileStream;
+	}
+	streamed = streamed_;
+	appending = false;
 
 	// clear header and footer
 	//
 	std::fill((uchar*)&fileHeader, (uchar*)&fileHeader + sizeof(DsrcFileHeader), 0);
 
 	fileFooter.blockSizes.clear();
+	fileFooter.blockRecords.clear();
 	fileFooter.dummyByte = 0;
 
 
-	// skip header pos
+	// skip header pos -- in the streamed layout the header is written
+	// along with the first block, when the settings are already known
 	//
-	fileStream->SetPosition(DsrcFileHeader::HeaderSize);
+	position = 0;
+	if (!streamed)
+	{
+		((FileStreamWriterExt*)stream)->SetPosition(DsrcFileHeader::HeaderSize);
+		position = DsrcFileHeader::HeaderSize;
+	}
 
 	currentBlockId = 0;
 }
 
+void DsrcFileWriter::StartAppend(const std::string& fileName_)
+{
+	ASSERT(stream == NULL);
+
+	// take the blocks and settings of the archive, the records index
+	// is computed for archives stored without it
+	//
+	DsrcFileReader reader;
+	reader.StartDecompress(fileName_);
+
+	if (reader.IsSequential())
+		throw DsrcException("Only archives stored in regular files can be appended");
+
+	if (!reader.HasRecordsIndex())
+		reader.ComputeRecordsIndex();
+
+	std::fill((uchar*)&fileHeader, (uchar*)&fileHeader + sizeof(DsrcFileHeader), 0);
+	fileHeader.recordsCount = reader.RecordsCount();
+
+	fileFooter = reader.GetFileFooter();
+	fileFooter.dummyByte = 0;
+	ASSERT(fileFooter.blockRecords.size() == fileFooter.blockSizes.size());
+
+	streamed = reader.IsStreamed();
+	const uint64 footerOffset = reader.GetFileHeader().footerOffset;
+
+	reader.FinishDecompress();
+
+	// the new blocks overwrite the footer and, in the streamed layout, the empty
+	// frame terminating the blocks -- a streamed archive footer can only grow,
+	// so its trailer stays at the end of the file
+	//
+	position = footerOffset - (streamed ? DsrcFileHeader::FrameHeaderSize : 0);
+
+	// keep the overwritten tail and the header to restore them when appending fails
+	//
+	{
+		FileStreamReaderExt original(fileName_);
+		originalSize = original.Size();
+		originalTailOffset = position;
+		originalTail.resize(originalSize - originalTailOffset);
+		originalHeader.resize(DsrcFileHeader::HeaderSize);
+
+		if (original.ReadAt(originalTailOffset, originalTail.data(), originalTail.size()) != (int64)originalTail.size()
+				|| original.ReadAt(0, originalHeader.data(), originalHeader.size()) != (int64)originalHeader.size())
+			throw DsrcException("Error reading DSRC archive");
+	}
+
+	FileStreamWriterExt* fileStream = new AsyncFileStreamWriter(fileName_, true, true);
+	stream = fileStream;
+	fileStream->SetPosition(position);
+
+	currentBlockId = fileFooter.blockSizes.size();
+	appending = true;
+}
+
+void DsrcFileWriter::SetDatasetType(const fq::FastqDatasetType& typeInfo_)
+{
+	if (appending && !IsSameDatasetType(typeInfo_, fileFooter.datasetType))
+		throw DsrcException("Dataset type differs from the appended archive one");
+
+	fileFooter.datasetType = typeInfo_;
+}
+
+void DsrcFileWriter::SetCompressionSettings(const CompressionSettings& settings_)
+{
+	if (appending && !IsSameCompressionSettings(settings_, fileFooter.compSettings))
+		throw DsrcException("Compression settings differ from the appended archive ones");
+
+	fileFooter.compSettings = settings_;
+}
+
 void DsrcFileWriter::WriteNextChunk(const DsrcDataChunk* block_)
 {
 	ASSERT(block_ != NULL);
 	ASSERT(block_->size > 0);
 
-	fileStream->Write(block_->data.Pointer(), block_->size);
+	if (streamed)
+	{
+		if (currentBlockId == 0)
+			WriteStreamHeader();
+
+		BitMemoryWriter frame(DsrcFileHeader::FrameHeaderSize);
+		frame.PutDWord(block_->size);
+		Write(frame.Pointer(), frame.Position());
+	}
+
+	Write(block_->data.Pointer(), block_->size);
 	fileFooter.blockSizes.push_back(block_->size);
+	fileFooter.blockRecords.push_back(block_->recordsCount);
+	fileHeader.recordsCount += block_->recordsCount;
 
 	for (uint32 i = 0; i < fq::StreamsInfo::StreamCount; ++i)
 	{
@@ -76,6 +205,16 @@ void DsrcFileWriter::FinishCompress()
 {
 	ASSERT(fileFooter.blockSizes.size() > 0);
 	ASSERT(fileFooter.blockSizes.size() == currentBlockId);
+	ASSERT(fileFooter.blockRecords.size() == currentBlockId);
+
+	// terminate the blocks frames
+	//
+	if (streamed)
+	{
+		BitMemoryWriter frame(DsrcFileHeader::FrameHeaderSize);
+		frame.PutDWord(0);
+		Write(frame.Pointer(), frame.Position());
+	}
 
 	// prepare header
 	//
@@ -85,8 +224,7 @@ void DsrcFileWriter::FinishCompress()
 	fileHeader.versionRev = DsrcFileHeader::VersionRev;
 	std::fill(fileHeader.reserved, fileHeader.reserved + DsrcFileHeader::ReservedBytes, +DsrcFileHeader::DummyByteValue);
 	fileHeader.blockCount = fileFooter.blockSizes.size();
-	fileHeader.recordsCount = 0; //! TODO!!!
-	fileHeader.footerOffset = fileStream->Position();
+	fileHeader.footerOffset = position;
 
 	// write footer
 	//
@@ -95,18 +233,133 @@ void DsrcFileWriter::FinishCompress()
 
 	// fill header and write
 	//
-	fileHeader.footerSize = fileStream->Position() - fileHeader.footerOffset;
+	fileHeader.footerSize = position - fileHeader.footerOffset;
 
-	fileStream->SetPosition(0);
-	WriteFileHeader();
+	if (streamed)
+	{
+		WriteStreamTrailer();
+	}
+	else
+	{
+		((FileStreamWriterExt*)stream)->SetPosition(0);
+		WriteFileHeader();
+	}
+
+	// the writes can be still pending
+	//
+	AsyncFileStreamWriter* asyncStream = dynamic_cast<AsyncFileStreamWriter*>(stream);
+	if (asyncStream != NULL)
+	{
+		asyncStream->Flush();
+		if (asyncStream->IsError())
+			throw DsrcException("Error writing DSRC archive");
+	}
 
 	// cool, exit
 	//
-	fileStream->Close();
+	stream->Close();
 
-	delete fileStream;
+	delete stream;
 
-	fileStream = NULL;
+	stream = NULL;
+}
+
+void DsrcFileWriter::AbortCompress()
+{
+	if (stream == NULL)
+		return;
+
+	// drop the appended blocks: the original footer and header are written
+	// back and the file is cut to its original size
+	//
+	if (appending)
+	{
+		AsyncFileStreamWriter* fileStream = (AsyncFileStreamWriter*)stream;
+
+		fileStream->SetPosition(originalTailOffset);
+		Write(originalTail.data(), originalTail.size());
+		fileStream->SetPosition(0);
+		Write(originalHeader.data(), originalHeader.size());
+
+		fileStream->Flush();
+		if (fileStream->IsError())
+			throw DsrcException("Error restoring DSRC archive");
+		fileStream->Truncate(originalSize);
+	}
+
+	stream->Close();
+
+	delete stream;
+
+	stream = NULL;
+}
+
+uint64 DsrcFileWriter::CopyBlocks(DsrcFileReader& reader_)
+{
+	ASSERT(stream != NULL);
+
+	// blocks depend on the archive settings only, models are reset per block
+	//
+	const fq::FastqDatasetType& type = reader_.GetDatasetType();
+	const CompressionSettings& settings = reader_.GetCompressionSettings();
+
+	if (!IsSameDatasetType(type, fileFooter.datasetType)
+			|| !IsSameCompressionSettings(settings, fileFooter.compSettings))
+	{
+		throw DsrcException("Archive dataset type or compression settings differ");
+	}
+
+	// the footer needs records count of each block
+	//
+	if (!reader_.HasRecordsIndex() && !reader_.IsSequential())
+		reader_.ComputeRecordsIndex();
+
+	const uint64 recordsCount = fileHeader.recordsCount;
+
+	DsrcDataChunk block;
+	while (reader_.ReadNextChunk(&block))
+	{
+		WriteNextChunk(&block);
+		block.Reset();
+	}
+
+	return fileHeader.recordsCount - recordsCount;
+}
+
+void DsrcFileWriter::Write(const uchar* mem_, uint64 size_)
+{
+	if (stream->Write(mem_, size_) != (int64)size_)
+		throw DsrcException("Error writing DSRC archive");
+	position += size_;
+}
+
+void DsrcFileWriter::WriteStreamHeader()
+{
+	ASSERT(position == 0);
+
+	// the footer location is not known yet and is stored in the trailer
+	//
+	fileHeader.dummyByte = DsrcFileHeader::DummyByteValue;
+	fileHeader.versionMajor = DsrcFileHeader::VersionMajor;
+	fileHeader.versionMinor = DsrcFileHeader::VersionMinor;
+	fileHeader.versionRev = DsrcFileHeader::VersionRev;
+	std::fill(fileHeader.reserved, fileHeader.reserved + DsrcFileHeader::ReservedBytes, +DsrcFileHeader::DummyByteValue);
+	WriteFileHeader();
+
+	BitMemoryWriter writer(DsrcFileFooter::DatasetTypeSize + DsrcFileFooter::CompressionSettingsSize);
+	fileFooter.StoreSettings(writer);
+	Write(writer.Pointer(), writer.Position());
+}
+
+void DsrcFileWriter::WriteStreamTrailer()
+{
+	BitMemoryWriter writer(DsrcFileHeader::TrailerSize);
+	writer.PutWord(fileHeader.footerSize);
+	writer.PutDWord(fileHeader.footerOffset);
+	writer.PutDWord(fileHeader.recordsCount);
+	writer.PutDWord(fileHeader.blockCount);
+
+	Write(writer.Pointer(), writer.Position());
 }
 
 void DsrcFileWriter::WriteFileHeader()
@@ -127,51 +380,91 @@ void DsrcFileWriter::WriteFileHeader()
 
 	writer.PutBytes(fileHeader.reserved, DsrcFileHeader::ReservedBytes);
 
-	fileStream->Write(writer.Pointer(), writer.Position());
+	Write(writer.Pointer(), writer.Position());
 }
 
 void DsrcFileWriter::WriteFileFooter()
 {	
-	// store data
+	// store data -- the buffer is extended if needed
 	//
-	BitMemoryWriter writer(fileFooter.blockSizes.size() * 4 + DsrcFileFooter::DatasetTypeSize + DsrcFileFooter::CompressionSettingsSize);
+	BitMemoryWriter writer(1 + fileFooter.blockSizes.size() * 4 * 2 + DsrcFileFooter::DatasetTypeSize + DsrcFileFooter::CompressionSettingsSize);
 	writer.PutByte(fileFooter.dummyByte);
 
 	// store blocks
 	//
-	writer.PutBytes((byte*)fileFooter.blockSizes.data(), fileFooter.blockSizes.size() * 4);
+	for (uint64 i = 0; i < fileFooter.blockSizes.size(); ++i)
+		writer.PutVarDWord(fileFooter.blockSizes[i]);
 
+	// store dataset and compression info
+	//
+	fileFooter.StoreSettings(writer);
+
+	// store records index -- one value per block following the settings,
+	// present since 2.1
+	//
+	for (uint64 i = 0; i < fileFooter.blockRecords.size(); ++i)
+		writer.PutVarDWord(fileFooter.blockRecords[i]);
+
+	// flush
+	//
+	Write(writer.Pointer(), writer.Position());
+}
+
+void DsrcFileFooter::StoreSettings(BitMemoryWriter& writer_) const
+{
 	// store dataset info
 	//
 	byte flags = 0;
-	if (fileFooter.datasetType.colorSpace)
-		flags |= DsrcFileFooter::FLAG_COLOR_SPACE;
-	if (fileFooter.datasetType.plusRepetition)
-		flags |= DsrcFileFooter::FLAG_PLUS_REPETITION;
+	if (datasetType.colorSpace)
+		flags |= FLAG_COLOR_SPACE;
+	if (datasetType.plusRepetition)
+		flags |= FLAG_PLUS_REPETITION;
 
-	writer.PutByte(flags);
-	writer.PutByte(fileFooter.datasetType.qualityOffset);
+	writer_.PutByte(flags);
+	writer_.PutByte(datasetType.qualityOffset);
 
 	// store compression info
 	//
 	flags = 0;
-	if (fileFooter.compSettings.lossy)
-		flags |= DsrcFileFooter::FLAG_LOSSY_QUALITY;
-	if (fileFooter.compSettings.calculateCrc32)
-		flags |= DsrcFileFooter::FLAG_CALCULATE_CRC32;
-	writer.PutByte(flags);
-	writer.PutByte(fileFooter.compSettings.dnaOrder);
-	writer.PutByte(fileFooter.compSettings.qualityOrder);
-	writer.PutDWord(fileFooter.compSettings.tagPreserveFlags);
+	if (compSettings.lossy)
+		flags |= FLAG_LOSSY_QUALITY;
+	if (compSettings.calculateCrc32)
+		flags |= FLAG_CALCULATE_CRC32;
+	writer_.PutByte(flags);
+	writer_.PutByte(compSettings.dnaOrder);
+	writer_.PutByte(compSettings.qualityOrder);
+	writer_.PutDWord(compSettings.tagPreserveFlags);
+}
 
-	// flush
+void DsrcFileFooter::ReadSettings(BitMemoryReader& reader_)
+{
+	// read dataset info
 	//
-	fileStream->Write(writer.Pointer(), writer.Position());
+	byte flags = reader_.GetByte();
+	datasetType.colorSpace = (flags & FLAG_COLOR_SPACE) != 0;
+	datasetType.plusRepetition = (flags & FLAG_PLUS_REPETITION) != 0;
+	datasetType.qualityOffset = reader_.GetByte();
+
+	// read compression info
+	//
+	flags = reader_.GetByte();
+	compSettings.lossy = (flags & FLAG_LOSSY_QUALITY);
+	compSettings.calculateCrc32 = (flags & FLAG_CALCULATE_CRC32);
+	compSettings.dnaOrder = reader_.GetByte();
+	compSettings.qualityOrder = reader_.GetByte();
+	compSettings.tagPreserveFlags = reader_.GetDWord();
 }
 
 DsrcFileReader::DsrcFileReader()
 	:	fileStream(NULL)
+	,	stdStream(NULL)
 	,	currentBlockId(0)
+	,	endBlockId(0)
+	,	streamed(false)
+	,	sequential(false)
+	,	nextRecord(0)
+	,	recordsBegin(0)
+	,	recordsEnd(0)
 {
 	std::fill((uchar*)&fileHeader, (uchar*)&fileHeader + sizeof(DsrcFileHeader), 0);
 	fileFooter.dummyByte = 0;
@@ -181,23 +474,34 @@ DsrcFileReader::~DsrcFileReader()
 {
 	if (fileStream)
 		delete fileStream;
+	if (stdStream)
+		delete stdStream;
 }
 
 void DsrcFileReader::StartDecompress(const std::string& fileName_)
 {
-	ASSERT(fileStream == NULL);
+	ASSERT(fileStream == NULL && stdStream == NULL);
 
-	fileStream = new FileStreamReaderExt(fileName_);
+	if (fileName_ == "-")
+	{
+		stdStream = new StdStreamReader();
+		sequential = true;
+	}
+	else
+	{
+		fileStream = new FileStreamReaderExt(fileName_);
+		sequential = !fileStream->IsSeekable();
 
-	if (fileStream->Size() == 0)
-		throw DsrcException("Empty file.");
+		if (!sequential && fileStream->Size() == 0)
+			throw DsrcException("Empty file.");
+	}
 
 	// Read file header
 	std::fill((uchar*)&fileHeader, (uchar*)&fileHeader + sizeof(DsrcFileHeader), 0);
 	ReadFileHeader();
 
 	// Check version compatibility
-	if (!(fileHeader.versionMajor == DsrcFileHeader::VersionMajor && fileHeader.versionMinor == DsrcFileHeader::VersionMinor))
+	if (!(fileHeader.versionMajor == DsrcFileHeader::VersionMajor && fileHeader.versionMinor <= DsrcFileHeader::VersionMinor))
 	{
 		//! TODO: add old file version checking
 		delete fileStream;
@@ -205,6 +509,40 @@ void DsrcFileReader::StartDecompress(const std::string& fileName_)
 		throw DsrcException("Invalid archive or old unsupported version");
 	}
 
+	// the footer of streamed archive is located by the trailer
+	//
+	const bool indexed = fileHeader.versionMinor >= DsrcFileHeader::MinIndexedVersionMinor;
+	streamed = fileHeader.footerOffset == 0 && indexed;
+
+	// without seeking only the settings preceding the blocks are available
+	//
+	if (sequential)
+	{
+		if (!streamed)
+			throw DsrcException("Only archives in the streamed layout can be read from a non-seekable input");
+
+		uchar settings[DsrcFileFooter::DatasetTypeSize + DsrcFileFooter::CompressionSettingsSize];
+		Read(settings, sizeof(settings));
+
+		BitMemoryReader reader(settings, sizeof(settings));
+		fileFooter.ReadSettings(reader);
+
+		fileFooter.blockSizes.clear();
+		fileFooter.blockRecords.clear();
+		blockOffsets.clear();
+		recordOffsets.clear();
+
+		currentBlockId = 0;
+		endBlockId = (uint64)-1;
+		nextRecord = 0;
+		recordsBegin = 0;
+		recordsEnd = (uint64)-1;
+		return;
+	}
+
+	if (streamed)
+		ReadStreamTrailer();
+
 	if ((fileHeader.blockCount == 0ULL) || fileHeader.footerOffset + (uint64)fileHeader.footerSize > fileStream->Size())
 	{
 		delete fileStream;
@@ -216,6 +554,9 @@ void DsrcFileReader::StartDecompress(const std::string& fileName_)
 	//
 	fileFooter.blockSizes.clear();
 	fileFooter.blockSizes.resize(fileHeader.blockCount, 0);
+	fileFooter.blockRecords.clear();
+	if (indexed)
+		fileFooter.blockRecords.resize(fileHeader.blockCount, 0);
 
 	fileStream->SetPosition(fileHeader.footerOffset);
 	ReadFileFooter();
@@ -227,34 +568,321 @@ void DsrcFileReader::StartDecompress(const std::string& fileName_)
 		throw DsrcException("Corrupted DSRC archive footer");
 	}
 
-	fileStream->SetPosition(DsrcFileHeader::HeaderSize);
+	BuildBlocksIndex();
+
+	fileStream->SetPosition(blockOffsets[0]);
 
 	currentBlockId = 0;
+	endBlockId = fileHeader.blockCount;
+}
+
+void DsrcFileReader::ReadStreamTrailer()
+{
+	if (fileStream->Size() < DsrcFileHeader::HeaderSize + DsrcFileHeader::TrailerSize)
+	{
+		delete fileStream;
+		fileStream = NULL;
+		throw DsrcException("Corrupted DSRC archive trailer");
+	}
+
+	uchar trailer[DsrcFileHeader::TrailerSize];
+	fileStream->SetPosition(fileStream->Size() - DsrcFileHeader::TrailerSize);
+	if (fileStream->Read(trailer, DsrcFileHeader::TrailerSize) != (int64)DsrcFileHeader::TrailerSize)
+	{
+		delete fileStream;
+		fileStream = NULL;
+		throw DsrcException("Corrupted DSRC archive trailer");
+	}
+
+	BitMemoryReader reader(trailer, DsrcFileHeader::TrailerSize);
+	fileHeader.footerSize = reader.GetWord();
+	fileHeader.footerOffset = reader.GetDWord();
+	fileHeader.recordsCount = reader.GetDWord();
+	fileHeader.blockCount = reader.GetDWord();
+
+	// the settings stored after the header are read again with the footer
+}
+
+void DsrcFileReader::BuildBlocksIndex()
+{
+	// in the streamed layout the offsets point at the blocks frames, the last
+	// one being the empty frame preceding the footer
+	//
+	const uint64 frameSize = streamed ? DsrcFileHeader::FrameHeaderSize : 0;
+
+	blockOffsets.resize(fileHeader.blockCount + 1);
+	blockOffsets[0] = DsrcFileHeader::HeaderSize;
+	if (streamed)
+		blockOffsets[0] += DsrcFileFooter::DatasetTypeSize + DsrcFileFooter::CompressionSettingsSize;
+	for (uint64 i = 0; i < fileHeader.blockCount; ++i)
+		blockOffsets[i + 1] = blockOffsets[i] + frameSize + fileFooter.blockSizes[i];
+
+	if (blockOffsets.back() + frameSize != fileHeader.footerOffset)
+	{
+		delete fileStream;
+		fileStream = NULL;
+		throw DsrcException("Corrupted DSRC archive footer");
+	}
+
+	recordOffsets.clear();
+	if (fileFooter.blockRecords.size() == 0)
+		return;
+
+	ASSERT(fileFooter.blockRecords.size() == fileHeader.blockCount);
+	recordOffsets.resize(fileHeader.blockCount + 1);
+	recordOffsets[0] = 0;
+	for (uint64 i = 0; i < fileHeader.blockCount; ++i)
+		recordOffsets[i + 1] = recordOffsets[i] + fileFooter.blockRecords[i];
+
+	if (recordOffsets.back() != fileHeader.recordsCount)
+	{
+		delete fileStream;
+		fileStream = NULL;
+		throw DsrcException("Corrupted DSRC archive records index");
+	}
 }
 
 bool DsrcFileReader::ReadNextChunk(DsrcDataChunk* block_)
 {
 	ASSERT(block_ != NULL);
 
-	if (currentBlockId == fileHeader.blockCount)
+	if (currentBlockId == endBlockId)
 	{
 		block_->size = 0;
 		return false;
 	}
 
+	if (sequential)
+	{
+		// skip the blocks preceding the records range
+		//
+		while (ReadNextFrame(block_))
+		{
+			if (block_->firstRecord >= recordsEnd)
+				break;
+
+			if (block_->firstRecord + block_->recordsCount > recordsBegin)
+				return true;
+		}
+
+		endBlockId = currentBlockId;
+		block_->size = 0;
+		return false;
+	}
+
+	if (HasRecordsIndex())
+	{
+		block_->firstRecord = recordOffsets[currentBlockId];
+		block_->recordsCount = fileFooter.blockRecords[currentBlockId];
+	}
+
 	block_->size = fileFooter.blockSizes[currentBlockId];
+
+	if (streamed)
+	{
+		uchar frame[DsrcFileHeader::FrameHeaderSize];
+		Read(frame, DsrcFileHeader::FrameHeaderSize);
+
+		BitMemoryReader reader(frame, DsrcFileHeader::FrameHeaderSize);
+		if (reader.GetDWord() != block_->size)
+			throw DsrcException("Corrupted DSRC archive block frame");
+	}
+
 	if (block_->data.Size() < block_->size)
 	{
 		block_->data.Extend(block_->size);
 	}
-	fileStream->Read(block_->data.Pointer(), block_->size);
+	Read(block_->data.Pointer(), block_->size);
 	currentBlockId++;
 
 	return true;
 }
 
+void DsrcFileReader::ReadChunkAt(uint64 blockId_, DsrcDataChunk* block_) const
+{
+	ASSERT(block_ != NULL);
+	ASSERT(fileStream != NULL);
+	ASSERT(!sequential);
+	ASSERT(blockId_ < fileHeader.blockCount);
+
+	if (HasRecordsIndex())
+	{
+		block_->firstRecord = recordOffsets[blockId_];
+		block_->recordsCount = fileFooter.blockRecords[blockId_];
+	}
+
+	block_->size = fileFooter.blockSizes[blockId_];
+
+	uint64 offset = blockOffsets[blockId_];
+	if (streamed)
+	{
+		uchar frame[DsrcFileHeader::FrameHeaderSize];
+		if (fileStream->ReadAt(offset, frame, DsrcFileHeader::FrameHeaderSize) != (int64)DsrcFileHeader::FrameHeaderSize)
+			throw DsrcException("Unexpected end of DSRC archive");
+
+		BitMemoryReader reader(frame, DsrcFileHeader::FrameHeaderSize);
+		if (reader.GetDWord() != block_->size)
+			throw DsrcException("Corrupted DSRC archive block frame");
+
+		offset += DsrcFileHeader::FrameHeaderSize;
+	}
+
+	if (block_->data.Size() < block_->size)
+	{
+		block_->data.Extend(block_->size);
+	}
+
+	if (fileStream->ReadAt(offset, block_->data.Pointer(), block_->size) != (int64)block_->size)
+		throw DsrcException("Unexpected end of DSRC archive");
+}
+
+bool DsrcFileReader::ReadNextFrame(DsrcDataChunk* block_)
+{
+	ASSERT(sequential);
+
+	uchar frame[DsrcFileHeader::FrameHeaderSize];
+	Read(frame, DsrcFileHeader::FrameHeaderSize);
+
+	BitMemoryReader frameReader(frame, DsrcFileHeader::FrameHeaderSize);
+	block_->size = frameReader.GetDWord();
+
+	// the empty frame terminates the blocks, the footer is not needed
+	//
+	if (block_->size == 0)
+		return false;
+
+	if (block_->data.Size() < block_->size)
+	{
+		block_->data.Extend(block_->size);
+	}
+	Read(block_->data.Pointer(), block_->size);
+
+	BitMemoryReader reader(block_->data.Pointer(), block_->size);
+	block_->firstRecord = nextRecord;
+	block_->recordsCount = BlockCompressor::ReadRecordsCount(reader);
+	nextRecord += block_->recordsCount;
+	currentBlockId++;
+
+	return true;
+}
+
+void DsrcFileReader::Read(uchar* mem_, uint64 size_)
+{
+	int64 n = (stdStream != NULL) ? stdStream->Read(mem_, size_) : fileStream->Read(mem_, size_);
+	if (n != (int64)size_)
+		throw DsrcException("Unexpected end of DSRC archive");
+}
+
+uint64 DsrcFileReader::SeekToRecord(uint64 recordIdx_)
+{
+	ASSERT(fileStream != NULL);
+	ASSERT(!sequential);
+
+	if (!HasRecordsIndex())
+		throw DsrcException("Archive does not contain records index");
+
+	if (recordIdx_ >= fileHeader.recordsCount)
+		throw DsrcException("Record number exceeds archive records count");
+
+	// find the last block starting at or before the record
+	uint64 blockId = std::upper_bound(recordOffsets.begin(), recordOffsets.end(), recordIdx_) - recordOffsets.begin() - 1;
+	ASSERT(blockId < fileHeader.blockCount);
+
+	fileStream->SetPosition(blockOffsets[blockId]);
+	currentBlockId = blockId;
+
+	return recordOffsets[blockId];
+}
+
+void DsrcFileReader::SetRecordsRange(uint64 begin_, uint64 end_)
+{
+	if (begin_ >= end_)
+		throw DsrcException("Empty records range");
+
+	if (sequential)
+	{
+		ASSERT(currentBlockId == 0);
+		recordsBegin = begin_;
+		recordsEnd = end_;
+		return;
+	}
+
+	ASSERT(fileStream != NULL);
+
+	SeekToRecord(begin_);
+
+	if (end_ > fileHeader.recordsCount)
+		end_ = fileHeader.recordsCount;
+
+	endBlockId = std::lower_bound(recordOffsets.begin(), recordOffsets.end(), end_) - recordOffsets.begin();
+	ASSERT(endBlockId > currentBlockId && endBlockId <= fileHeader.blockCount);
+}
+
+void DsrcFileReader::ComputeRecordsIndex()
+{
+	ASSERT(fileStream != NULL);
+	ASSERT(!sequential);
+	ASSERT(currentBlockId == 0);
+
+	// only the first bytes of each block holding the chunk header are read
+	//
+	const uint64 prefixSize = 16;
+	uchar prefix[prefixSize];
+
+	fileFooter.blockRecords.resize(fileHeader.blockCount);
+	fileHeader.recordsCount = 0;
+	for (uint64 i = 0; i < fileHeader.blockCount; ++i)
+	{
+		const uint64 size = MIN(prefixSize, fileFooter.blockSizes[i]);
+
+		fileStream->SetPosition(blockOffsets[i] + (streamed ? DsrcFileHeader::FrameHeaderSize : 0));
+		if (fileStream->Read(prefix, size) != (int64)size)
+			throw DsrcException("Unexpected end of DSRC archive");
+
+		BitMemoryReader reader(prefix, size);
+		fileFooter.blockRecords[i] = BlockCompressor::ReadRecordsCount(reader);
+		fileHeader.recordsCount += fileFooter.blockRecords[i];
+	}
+
+	BuildBlocksIndex();
+
+	fileStream->SetPosition(blockOffsets[0]);
+}
+
+uint64 DsrcFileReader::MaxBlockBufferSize() const
+{
+	if (sequential || fileFooter.blockSizes.size() == 0)
+		return 0;
+
+	const uint64 blockId = std::max_element(fileFooter.blockSizes.begin(), fileFooter.blockSizes.end())
+						   - fileFooter.blockSizes.begin();
+	const uint64 packedSize = fileFooter.blockSizes[blockId];
+
+	// only the first bytes of the block holding the chunk header are read
+	//
+	const uint64 prefixSize = 32;
+	uchar prefix[prefixSize];
+	const uint64 size = MIN(prefixSize, packedSize);
+
+	const uint64 offset = blockOffsets[blockId] + (streamed ? DsrcFileHeader::FrameHeaderSize : 0);
+	if (fileStream->ReadAt(offset, prefix, size) != (int64)size)
+		throw DsrcException("Unexpected end of DSRC archive");
+
+	BitMemoryReader reader(prefix, size);
+	const uint64 chunkSize = BlockCompressor::ReadChunkSize(reader);
+
+	return MAX(chunkSize, packedSize);
+}
+
 void DsrcFileReader::FinishDecompress()
 {
+	if (stdStream != NULL)
+	{
+		delete stdStream;
+		stdStream = NULL;
+		return;
+	}
+
 	fileStream->Close();
 
 	delete fileStream;
@@ -266,7 +894,7 @@ void DsrcFileReader::ReadFileHeader()
 	// TODO: here we can just read directly whole header structure from IO
 	//
 	Buffer buffer(DsrcFileHeader::HeaderSize);
-	fileStream->Read(buffer.Pointer(), DsrcFileHeader::HeaderSize);
+	Read(buffer.Pointer(), DsrcFileHeader::HeaderSize);
 
 	BitMemoryReader reader(buffer.Pointer(), DsrcFileHeader::HeaderSize);
 	fileHeader.dummyByte = reader.GetByte();
@@ -291,26 +919,28 @@ void DsrcFileReader::ReadFileFooter()
 	BitMemoryReader reader(buffer.Pointer(), fileHeader.footerSize);
 	fileFooter.dummyByte = reader.GetByte();
 
-	// read blocks
+	// read blocks -- stored as raw 32-bit values in 2.0
 	//
-	reader.GetBytes((byte*)fileFooter.blockSizes.data(), fileFooter.blockSizes.size() * 4);
-
+	if (fileHeader.versionMinor >= DsrcFileHeader::MinIndexedVersionMinor)
+	{
+		for (uint64 i = 0; i < fileFooter.blockSizes.size(); ++i)
+			fileFooter.blockSizes[i] = reader.GetVarDWord();
+	}
+	else
+	{
+		std::vector<uint32> sizes(fileFooter.blockSizes.size());
+		reader.GetBytes((byte*)sizes.data(), sizes.size() * 4);
+		std::copy(sizes.begin(), sizes.end(), fileFooter.blockSizes.begin());
+	}
 
-	// read dataset info
+	// read dataset and compression info
 	//
-	byte flags = reader.GetByte();
-	fileFooter.datasetType.colorSpace = (flags & DsrcFileFooter::FLAG_COLOR_SPACE) != 0;
-	fileFooter.datasetType.plusRepetition = (flags & DsrcFileFooter::FLAG_PLUS_REPETITION) != 0;
-	fileFooter.datasetType.qualityOffset = reader.GetByte();
+	fileFooter.ReadSettings(reader);
 
-	// read compression info
+	// read records index, empty in 2.0
 	//
-	flags = reader.GetByte();
-	fileFooter.compSettings.lossy = (flags & DsrcFileFooter::FLAG_LOSSY_QUALITY);
-	fileFooter.compSettings.calculateCrc32 = (flags & DsrcFileFooter::FLAG_CALCULATE_CRC32);
-	fileFooter.compSettings.dnaOrder = reader.GetByte();
-	fileFooter.compSettings.qualityOrder = reader.GetByte();
-	fileFooter.compSettings.tagPreserveFlags = reader.GetDWord();
+	for (uint64 i = 0; i < fileFooter.blockRecords.size(); ++i)
+		fileFooter.blockRecords[i] = reader.GetVarDWord();
 }
 
 } // namespace comp
@@ -15,6 +15,7 @@
 
 #include "Common.h"
 #include "FileStream.h"
+#include "StdStream.h"
 #include "Fastq.h"
 
 namespace dsrc
@@ -30,8 +31,16 @@ struct DsrcFileHeader
 	static const uint32 HeaderSize				= 4 + ReservedBytes + 3*8 + 4;
 
 	static const uint32 VersionMajor = 2;
-	static const uint32 VersionMinor = 0;
-	static const uint32 VersionRev = 2;
+	static const uint32 VersionMinor = 1;
+	static const uint32 VersionRev = 0;
+
+	static const uint32 MinIndexedVersionMinor = 1;		// first version storing varint footer entries and records index
+
+	// streamed layout: the header is written with zeroed footer location, followed by the
+	// dataset and compression settings and size-prefixed block frames terminated by an empty
+	// frame, the footer and the trailer repeating the header fields
+	static const uint32 FrameHeaderSize			= 8;
+	static const uint32 TrailerSize				= 4 + 3*8;
 
 	uchar	dummyByte;
 	uchar	versionMajor;
@@ -69,44 +78,81 @@ struct DsrcFileFooter
 		FLAG_CALCULATE_CRC32	= BIT(1)
 	};
 
-	std::vector<uint32> blockSizes;
+	std::vector<uint64> blockSizes;
+	std::vector<uint64> blockRecords;		// records count per block, stored since 2.1
 
 	// TODO: serializer/deserializer
+	void StoreSettings(core::BitMemoryWriter& writer_) const;
+	void ReadSettings(core::BitMemoryReader& reader_);
 };
 
 
+class DsrcFileReader;
+
 class DsrcFileWriter
 {
-	core::FileStreamWriterExt* fileStream;
+	core::IDataStreamWriter* stream;
 	DsrcFileHeader fileHeader;
 	DsrcFileFooter fileFooter;
 
 	uint64 currentBlockId;
+	uint64 position;
+	bool streamed;
+	bool appending;
+
+	// the appended archive tail (footer and trailer) and header, restored on failure
+	std::vector<uchar> originalTail;
+	std::vector<uchar> originalHeader;
+	uint64 originalTailOffset;
+	uint64 originalSize;
 
 	fq::StreamsInfo fastqStreamInfo;
 	fq::StreamsInfo dsrcStreamInfo;
 
 	void WriteFileHeader();
 	void WriteFileFooter();
+	void WriteStreamHeader();
+	void WriteStreamTrailer();
+	void Write(const uchar* mem_, uint64 size_);
 
 public:
 	DsrcFileWriter();
 	~DsrcFileWriter();
 
-	void StartCompress(const std::string& filename_);
-	void SetDatasetType(const fq::FastqDatasetType& typeInfo_)
+	// uses the streamed layout when requested or when the output is not seekable,
+	// "-" selects the standard output
+	void StartCompress(const std::string& filename_, bool streamed_ = false);
+
+	// continues the existing archive: the new blocks are written in place of its footer,
+	// the extended footer and the header (or the trailer) are rewritten on finish,
+	// the dataset type and compression settings are taken from the archive
+	void StartAppend(const std::string& filename_);
+
+	// when appending, the values need to match the archive ones
+	void SetDatasetType(const fq::FastqDatasetType& typeInfo_);
+	void SetCompressionSettings(const CompressionSettings& settings_);
+
+	const fq::FastqDatasetType& GetDatasetType() const
 	{
-		fileFooter.datasetType = typeInfo_;
+		return fileFooter.datasetType;
 	}
 
-	void SetCompressionSettings(const CompressionSettings& settings_)
+	const CompressionSettings& GetCompressionSettings() const
 	{
-		fileFooter.compSettings = settings_;
+		return fileFooter.compSettings;
 	}
 
 	void WriteNextChunk(const DsrcDataChunk* block_);
 	void FinishCompress();
 
+	// closes the archive after a failure: the appended archive is restored to its
+	// original contents, a new one is left incomplete
+	void AbortCompress();
+
+	// copies all the blocks of the opened archive as they are, the archive needs to
+	// share the dataset type and compression settings, returns copied records count
+	uint64 CopyBlocks(DsrcFileReader& reader_);
+
 	const fq::StreamsInfo& GetFastqStreamInfo() const
 	{
 		return fastqStreamInfo;
@@ -116,24 +162,59 @@ public:
 	{
 		return dsrcStreamInfo;
 	}
+
+	bool IsStreamed() const
+	{
+		return streamed;
+	}
+
+	bool IsAppending() const
+	{
+		return appending;
+	}
+
+	uint64 BlockCount() const
+	{
+		return currentBlockId;
+	}
 };
 
 
 class DsrcFileReader
 {
 	core::FileStreamReaderExt*	fileStream;
+	core::StdStreamReader* stdStream;
 	DsrcFileHeader fileHeader;
 	DsrcFileFooter fileFooter;
 
 	uint64 currentBlockId;
+	uint64 endBlockId;
+	bool streamed;
+
+	// non-seekable input: streamed archive blocks are read strictly sequentially,
+	// the records range is applied while reading
+	bool sequential;
+	uint64 nextRecord;
+	uint64 recordsBegin;
+	uint64 recordsEnd;
+
+	// blocks index: file offset and first record number of each block,
+	// both with an extra end entry
+	std::vector<uint64> blockOffsets;
+	std::vector<uint64> recordOffsets;
 
 	void ReadFileHeader();
 	void ReadFileFooter();
+	void ReadStreamTrailer();
+	void BuildBlocksIndex();
+	bool ReadNextFrame(DsrcDataChunk* block_);
+	void Read(uchar* mem_, uint64 size_);
 
 public:
 	DsrcFileReader();
 	~DsrcFileReader();
 
+	// "-" selects the standard input, non-seekable inputs are read sequentially
 	void StartDecompress(const std::string& fileName_);
 
 	const fq::FastqDatasetType& GetDatasetType() const
@@ -146,13 +227,73 @@ public:
 		return fileFooter.compSettings;
 	}
 
+	const DsrcFileHeader& GetFileHeader() const
+	{
+		return fileHeader;
+	}
+
+	const DsrcFileFooter& GetFileFooter() const
+	{
+		return fileFooter;
+	}
+
 	bool ReadNextChunk(DsrcDataChunk* block_);
 	void FinishDecompress();
 
+	// positional read of the given block from [FirstBlockId(), EndBlockId()) range,
+	// can be called concurrently, not available for sequential input
+	void ReadChunkAt(uint64 blockId_, DsrcDataChunk* block_) const;
+
+	uint64 FirstBlockId() const
+	{
+		return currentBlockId;
+	}
+
+	uint64 EndBlockId() const
+	{
+		return endBlockId;
+	}
+
+	// positions the reader at the block containing the given record,
+	// returns the number of the first record stored in that block
+	uint64 SeekToRecord(uint64 recordIdx_);
+
+	// limits reading to the blocks overlapping records [begin, end)
+	void SetRecordsRange(uint64 begin_, uint64 end_);
+
+	// builds the records index from the blocks headers, used for archives
+	// stored without the index
+	void ComputeRecordsIndex();
+
+	// size of a buffer holding the largest stored block, compressed or not --
+	// taken from the header of the largest compressed one, 0 when the blocks
+	// are not known in advance (sequential input)
+	uint64 MaxBlockBufferSize() const;
+
+	bool HasRecordsIndex() const
+	{
+		return recordOffsets.size() > 0;
+	}
+
+	bool IsSequential() const
+	{
+		return sequential;
+	}
+
+	bool IsStreamed() const
+	{
+		return streamed;
+	}
+
 	uint64 BlockCount() const
 	{
 		return fileHeader.blockCount;
 	}
+
+	uint64 RecordsCount() const
+	{
+		return fileHeader.recordsCount;
+	}
 };
 
 } // namespace comp
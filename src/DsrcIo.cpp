@@ -10,6 +10,13 @@
 #include "DsrcIo.h"
 #include "ErrorHandler.h"
 
+#ifdef USE_BOOST_THREAD
+#include <boost/thread.hpp>
+#include <boost/bind.hpp>
+#else
+#include <thread>
+#endif
+
 namespace dsrc
 {
 
@@ -19,94 +26,156 @@ namespace comp
 void DsrcWriter::operator()()
 {
 	int64 partId = 0;
-	int64 lastPartId = -1;
 
 	DsrcDataChunk* part = NULL;
-	std::map<int64, DsrcDataChunk*> partsQueue;
+	core::TReorderBuffer<DsrcDataChunk> partsQueue(dsrcPool.MaxPartNum());
 
-	while (!errorHandler.IsError() && dsrcQueue.Pop(partId, part))
+	// a failed write or verification stops writing, the remaining parts
+	// are only released to unblock the compressing threads
+	//
+	try
 	{
-		ASSERT(part->size < (1 << 30));
-
-		if (partId != lastPartId + 1)
+		while (!errorHandler.IsError() && dsrcQueue.Pop(partId, part))
 		{
-			ASSERT(partsQueue.count(partId) == 0);
-			partsQueue.insert(std::make_pair(partId, part));
-			continue;
-		}
-
-		dsrcWriter.WriteNextChunk(part);
+			ASSERT(part->size > 0);
 
-		lastPartId++;
+			partsQueue.Push(partId, part);
+			part = NULL;
 
-		dsrcPool.Release(part);
-		part = NULL;
-
-		while (partsQueue.size() > 0)
-		{
-			partId = partsQueue.begin()->first;
-			if (partId == lastPartId + 1)
+			while (!errorHandler.IsError() && partsQueue.Pop(part))
 			{
-				part = partsQueue.begin()->second;
-
 				dsrcWriter.WriteNextChunk(part);
 
-				lastPartId++;
-
 				dsrcPool.Release(part);
-				partsQueue.erase(partsQueue.begin());
-			}
-			else
-			{
-				break;
+				part = NULL;
 			}
 		}
-
-		part = NULL;
 	}
-
-	while (!errorHandler.IsError() && partsQueue.size() > 0)
+	catch (const std::exception& e_)
 	{
-		partId = partsQueue.begin()->first;
-		if (partId == lastPartId + 1)
-		{
-			part = partsQueue.begin()->second;
+		errorHandler.SetError(e_.what());
+	}
 
-			dsrcWriter.WriteNextChunk(part);
+	if (errorHandler.IsError())
+	{
+		if (part != NULL)
+			dsrcPool.Release(part);
 
-			lastPartId++;
+		while (partsQueue.Drain(part))
+			dsrcPool.Release(part);
 
+		while (dsrcQueue.Pop(partId, part))
 			dsrcPool.Release(part);
-			partsQueue.erase(partsQueue.begin());
-		}
-		else
-		{
-			break;
-		}
 	}
 
-	ASSERT(errorHandler.IsError() || partsQueue.size() == 0);
+	reorderStats = partsQueue.GetStats();
+
+	ASSERT(errorHandler.IsError() || partsQueue.IsEmpty());
 }
 
 void DsrcReader::operator()()
 {
+	// sequential input can be read only by a single thread
+	//
+	if (ioThreadsNum > 1 && !dsrcReader.IsSequential())
+	{
+		firstBlockId = dsrcReader.FirstBlockId();
+		endBlockId = dsrcReader.EndBlockId();
+		nextBlockId = firstBlockId;
+		nextPushBlockId = firstBlockId;
+
+#ifdef USE_BOOST_THREAD
+		boost::thread_group ioThreadGroup;
+		for (uint32 i = 0; i < ioThreadsNum; ++i)
+			ioThreadGroup.create_thread(boost::bind(&DsrcReader::ReadBlocks, this));
+		ioThreadGroup.join_all();
+#else
+		std::vector<th::thread> ioThreadGroup;
+		for (uint32 i = 0; i < ioThreadsNum; ++i)
+			ioThreadGroup.push_back(th::thread(&DsrcReader::ReadBlocks, this));
+		for (th::thread& t : ioThreadGroup)
+			t.join();
+#endif
+
+		dsrcQueue.SetCompleted();
+		return;
+	}
+
 	int64 partId = 0;
 	DsrcDataChunk* part = NULL;
 
 	dsrcPool.Acquire(part);
 
 	// waste of last SB --> TODO: fix it, eg. while !EOF
-	while (!errorHandler.IsError() && dsrcReader.ReadNextChunk(part))
+	// reading sequential input can fail midway
+	try
 	{
-		ASSERT(part->size < (1 << 30));
+		while (!errorHandler.IsError() && dsrcReader.ReadNextChunk(part))
+		{
+			ASSERT(part->size > 0);
 
-		dsrcQueue.Push(partId++, part);
-		dsrcPool.Acquire(part);
+			dsrcQueue.Push(partId++, part);
+			dsrcPool.Acquire(part);
+		}
+	}
+	catch (const std::exception& e_)
+	{
+		errorHandler.SetError(e_.what());
 	}
 
 	dsrcQueue.SetCompleted();
 }
 
+void DsrcReader::ReadBlocks()
+{
+	DsrcDataChunk* part = NULL;
+
+	try
+	{
+		for ( ;; )
+		{
+			dsrcPool.Acquire(part);
+
+			uint64 blockId = 0;
+			{
+				th::lock_guard<th::mutex> lock(claimMutex);
+				if (errorHandler.IsError() || nextBlockId == endBlockId)
+					break;
+				blockId = nextBlockId++;
+			}
+
+			dsrcReader.ReadChunkAt(blockId, part);
+			ASSERT(part->size > 0);
+
+			// keeping the queue in the blocks order bounds the reordering
+			// done after decompression, as with a single reader
+			//
+			th::unique_lock<th::mutex> lock(pushMutex);
+			while (nextPushBlockId != blockId && !errorHandler.IsError())
+				pushCondition.wait(lock);
+
+			if (errorHandler.IsError())
+				break;
+
+			dsrcQueue.Push(blockId - firstBlockId, part);
+			part = NULL;
+
+			nextPushBlockId++;
+			pushCondition.notify_all();
+		}
+	}
+	catch (const std::exception& e_)
+	{
+		errorHandler.SetError(e_.what());
+
+		th::lock_guard<th::mutex> lock(pushMutex);
+		pushCondition.notify_all();
+	}
+
+	if (part != NULL)
+		dsrcPool.Release(part);
+}
+
 } // namespace comp
 
 } // namespace dsrc
@@ -15,10 +15,10 @@
 #include "Buffer.h"
 #include "DataQueue.h"
 #include "DataPool.h"
+#include "ReorderBuffer.h"
 #include "DsrcFile.h"
 
 #include <vector>
-#include <map>
 
 namespace dsrc
 {
@@ -30,14 +30,20 @@ struct DsrcDataChunk : public core::DataChunk
 {
 	fq::StreamsInfo rawStreamsInfo;
 	fq::StreamsInfo compStreamsInfo;
+	uint64 firstRecord;
+	uint64 recordsCount;
 
 	DsrcDataChunk(uint64 bufferSize_ = core::DataChunk::DefaultBufferSize)
 		:	core::DataChunk(bufferSize_)
+		,	firstRecord(0)
+		,	recordsCount(0)
 	{}
 
 	void Reset()
 	{
 		core::DataChunk::Reset();
+		firstRecord = 0;
+		recordsCount = 0;
 		rawStreamsInfo.Clear();
 		compStreamsInfo.Clear();
 	}
@@ -68,6 +74,7 @@ protected:
 class DsrcWriter : public IDsrcIoOperator
 {
 	DsrcFileWriter& dsrcWriter;
+	core::ReorderStats reorderStats;
 
 public:
 	DsrcWriter(DsrcFileWriter& writer_, DsrcDataQueue& queue_, DsrcDataPool& pool_, core::ErrorHandler& errorHandler_)
@@ -76,17 +83,42 @@ public:
 	{}
 
 	void operator()();
+
+	const core::ReorderStats& GetReorderStats() const
+	{
+		return reorderStats;
+	}
 };
 
 
 class DsrcReader : public IDsrcIoOperator
 {
 	DsrcFileReader& dsrcReader;
+	const uint32 ioThreadsNum;
+
+	// parallel mode: the blocks are claimed in order, fetched concurrently
+	// by positional reads and pushed to the queue in order
+	uint64 firstBlockId;
+	uint64 endBlockId;
+	uint64 nextBlockId;
+	uint64 nextPushBlockId;
+
+	th::mutex claimMutex;
+	th::mutex pushMutex;
+	th::condition_variable pushCondition;
+
+	void ReadBlocks();
 
 public:
-	DsrcReader(DsrcFileReader& reader_, DsrcDataQueue& queue_, DsrcDataPool& pool_, core::ErrorHandler& errorHandler_)
+	DsrcReader(DsrcFileReader& reader_, DsrcDataQueue& queue_, DsrcDataPool& pool_, core::ErrorHandler& errorHandler_,
+			   uint32 ioThreadsNum_ = 1)
 		:	IDsrcIoOperator(queue_, pool_, errorHandler_)
 		,	dsrcReader(reader_)
+		,	ioThreadsNum(ioThreadsNum_)
+		,	firstBlockId(0)
+		,	endBlockId(0)
+		,	nextBlockId(0)
+		,	nextPushBlockId(0)
 	{}
 
 	void operator()();
@@ -69,6 +69,15 @@ void DsrcModule::Compress(const std::string &inputFilename_, const std::string &
 
 void DsrcModule::Decompress(const std::string &inputFilename_, const std::string &outputFilename_)
 {
+	DecompressRecords(inputFilename_, outputFilename_, 0, InputParameters::DefaultRecordsEnd);
+}
+
+void DsrcModule::DecompressRecords(const std::string &inputFilename_, const std::string &outputFilename_,
+								   uint64 firstRecord_, uint64 recordsCount_)
+{
+	if (recordsCount_ == 0)
+		throw DsrcException("Empty records range");
+
 	IDsrcOperator* dsrc;
 
 	if (GetThreadsNumber() > 0)
@@ -79,6 +88,9 @@ void DsrcModule::Decompress(const std::string &inputFilename_, const std::string
 	InputParameters params = *(const InputParameters*)GetInputParameters();
 	params.inputFilename = inputFilename_;
 	params.outputFilename = outputFilename_;
+	params.recordsBegin = firstRecord_;
+	if (recordsCount_ < InputParameters::DefaultRecordsEnd - firstRecord_)
+		params.recordsEnd = firstRecord_ + recordsCount_;
 	if (!dsrc->Process(params))
 	{
 		std::string err = dsrc->GetError();
@@ -16,6 +16,7 @@
 #include "DsrcWorker.h"
 #include "FastqParser.h"
 #include "BlockCompressor.h"
+#include "AsyncFileStream.h"
 #include "utils.h"
 #include "ErrorHandler.h"
 
@@ -44,11 +45,120 @@ using namespace fq;
 const uint32 IDsrcOperator::AvailableHardwareThreadsNum = th::thread::hardware_concurrency();
 
 
+// how long the blocks processed ahead of their turn waited for the writer,
+// long waits mean that a slow block holds up the pipeline
+//
+static void WriteReorderStats(std::ostream& ss_, const ReorderStats& stats_)
+{
+	ss_ << "Reordering: " << stats_.waitedPartsNum << " of " << stats_.partsNum << " blocks waited, "
+		<< std::fixed << std::setprecision(1)
+		<< "total: " << stats_.totalWaitUs / 1000.0 << " ms, "
+		<< "max: " << stats_.maxWaitUs / 1000.0 << " ms\n";
+}
+
+
+static uint64 SizeMB(uint64 size_)
+{
+	return (size_ + (1 << 20) - 1) >> 20;
+}
+
+
+void IDsrcOperator::EstimateMemory(MemoryPlan& plan_, const CompressionSettings& settings_)
+{
+	// a FASTQ and a DSRC pool, every part holding up to a block, and
+	// a block read by every parallel reader and decoded by every verifying thread
+	//
+	plan_.poolsSize = (2 * (uint64)plan_.PartNum() + plan_.ioThreadNum + plan_.verifyThreadNum) * plan_.blockSize;
+	plan_.compressorsSize = (plan_.threadNum + plan_.verifyThreadNum)
+							* BlockCompressor::EstimateMemorySize(settings_, plan_.blockSize,
+																  BlockCompressor::UseParallelStreams(plan_.threadNum));
+	plan_.buffersSize = AsyncFileStreamWriter::DefaultBufferSize * AsyncFileStreamWriter::DefaultBufferNum
+						+ plan_.inputBuffersSize;
+}
+
+
+void IDsrcOperator::FitMemoryLimit(MemoryPlan& plan_, CompressionSettings& settings_, uint32 adjustFlags_)
+{
+	EstimateMemory(plan_, settings_);
+	const MemoryPlan initialPlan = plan_;
+
+	// the steps go from the least costly in speed and compression ratio:
+	// fewer parts read ahead, smaller blocks, lower models order and
+	// finally fewer threads
+	//
+	while (!plan_.FitsLimit())
+	{
+		if ((adjustFlags_ & MemoryPlan::ADJUST_PARTS) && plan_.partsPerThread > MemoryPlan::MinPartsPerThread)
+			plan_.partsPerThread--;
+		else if ((adjustFlags_ & MemoryPlan::ADJUST_BLOCK_SIZE) && plan_.blockSize > MemoryPlan::MinBlockSize)
+			plan_.blockSize = MAX(plan_.blockSize / 2, MemoryPlan::MinBlockSize);
+		else if ((adjustFlags_ & MemoryPlan::ADJUST_MODELS) && settings_.qualityOrder > 0)
+			settings_.qualityOrder -= settings_.lossy ? 3 : 1;		// one compression level down
+		else if ((adjustFlags_ & MemoryPlan::ADJUST_MODELS) && settings_.dnaOrder > 0)
+			settings_.dnaOrder -= 3;
+		else if ((adjustFlags_ & MemoryPlan::ADJUST_THREADS) && plan_.threadNum > 1)
+		{
+			plan_.threadNum--;
+			plan_.verifyThreadNum = MIN(plan_.verifyThreadNum, plan_.threadNum);
+		}
+		else
+			break;
+
+		EstimateMemory(plan_, settings_);
+	}
+
+	// the later steps may have freed more than needed, so give the blocks
+	// and then the parts back as far as they fit
+	//
+	while (plan_.FitsLimit())
+	{
+		MemoryPlan plan = plan_;
+		if (plan.blockSize < initialPlan.blockSize)
+			plan.blockSize = MIN(plan.blockSize * 2, initialPlan.blockSize);
+		else if (plan.partsPerThread < initialPlan.partsPerThread)
+			plan.partsPerThread++;
+		else
+			break;
+
+		EstimateMemory(plan, settings_);
+		if (!plan.FitsLimit())
+			break;
+		plan_ = plan;
+	}
+}
+
+
+void IDsrcOperator::AddMemoryPlanLog(const MemoryPlan& plan_, const CompressionSettings& settings_)
+{
+	std::ostringstream ss;
+	ss << "Memory plan (in MB)\n";
+	ss << "Threads: " << plan_.threadNum;
+	if (plan_.verifyThreadNum > 0)
+		ss << ", verifying threads: " << plan_.verifyThreadNum;
+	if (plan_.ioThreadNum > 0)
+		ss << ", reading threads: " << plan_.ioThreadNum;
+	ss << ", parts: " << plan_.PartNum() << ", block size: " << SizeMB(plan_.blockSize)
+	   << ", DNA order: " << settings_.dnaOrder << ", quality order: " << settings_.qualityOrder << '\n';
+	ss << "Parts:       " << std::setw(10) << SizeMB(plan_.poolsSize) << '\n';
+	ss << "Compressors: " << std::setw(10) << SizeMB(plan_.compressorsSize) << '\n';
+	ss << "Buffers:     " << std::setw(10) << SizeMB(plan_.buffersSize) << '\n';
+	ss << "Total:       " << std::setw(10) << SizeMB(plan_.TotalSize());
+	if (plan_.limit != 0)
+		ss << " / " << SizeMB(plan_.limit);
+	ss << '\n';
+
+	if (!plan_.FitsLimit())
+		ss << "The memory limit cannot be met, using the smallest pipeline\n";
+	AddLog(ss.str());
+}
+
+
 bool DsrcCompressorST::Process(const InputParameters &args_)
 {
 	ASSERT(!IsError());
 
 	IFastqStreamReader* reader = NULL;
+	FastqGzipFileReader* gzipReader = NULL;
 	DsrcFileWriter* writer = NULL;
 
 	// make reusable
@@ -65,20 +175,49 @@ bool DsrcCompressorST::Process(const InputParameters &args_)
 	{
 		if (args_.useFastqStdIo)
 			reader = new FastqStdIoReader();
+		else if (GzipFileStreamReader::IsGzipFile(args_.inputFilename))
+			reader = gzipReader = new FastqGzipFileReader(args_.inputFilename);
+		else if (MappedFileStreamReader::IsMappable(args_.inputFilename))
+			reader = new FastqMappedFileReader(args_.inputFilename);
 		else
 			reader = new FastqFileReader(args_.inputFilename);
 
 		// join into constructor for RAII style
 		writer = new DsrcFileWriter();
-		writer->StartCompress(args_.outputFilename);
+		if (args_.appendArchive)
+		{
+			writer->StartAppend(args_.outputFilename);
+			settings = writer->GetCompressionSettings();
+			settings.ransStreams = args_.ransStreams;		// chosen per block
+		}
+		else
+		{
+			writer->StartCompress(args_.outputFilename, args_.streamedArchive);
+		}
+
+		// the appended records have to use the archive settings
+		//
+		uint32 adjustFlags = MemoryPlan::ADJUST_BLOCK_SIZE;
+		if (!args_.appendArchive)
+			adjustFlags |= MemoryPlan::ADJUST_MODELS;
+
+		MemoryPlan plan(1, 1, (uint64)args_.fastqBufferSizeMB << 20, (uint64)args_.memoryLimitMB << 20);
+		if (gzipReader != NULL)
+			plan.inputBuffersSize = gzipReader->BuffersSize();
+		FitMemoryLimit(plan, settings, adjustFlags);
+		AddMemoryPlanLog(plan, settings);
 
 		dsrcChunk = new DsrcDataChunk(DsrcDataChunk::DefaultBufferSize);
-		fastqChunk = new FastqDataChunk(args_.fastqBufferSizeMB << 20);
+		fastqChunk = new FastqDataChunk(plan.blockSize);
 
-		// analyze the header
+		// analyze the header -- the appended records use the archive quality offset
 		//
-		const bool findQOffset = args_.qualityOffset == fq::FastqDatasetType::AutoQualityOffset;
-		if (!findQOffset)
+		const bool findQOffset = args_.qualityOffset == fq::FastqDatasetType::AutoQualityOffset && !args_.appendArchive;
+		if (args_.appendArchive)
+		{
+			datasetType.qualityOffset = writer->GetDatasetType().qualityOffset;
+		}
+		else if (!findQOffset)
 		{
 			datasetType.qualityOffset = args_.qualityOffset;
 		}
@@ -92,7 +231,7 @@ bool DsrcCompressorST::Process(const InputParameters &args_)
 		writer->SetDatasetType(datasetType);
 		writer->SetCompressionSettings(settings);
 	}
-	catch (const std::runtime_error& e_)
+	catch (const std::exception& e_)
 	{
 		AddError(e_.what());
 	}
@@ -100,37 +239,48 @@ bool DsrcCompressorST::Process(const InputParameters &args_)
 	if (!IsError())
 	{
 		BitMemoryWriter bitMemory(dsrcChunk->data);
-		BlockCompressor superblock(datasetType, settings);
+		BlockCompressor superblock(datasetType, settings, BlockCompressor::UseParallelStreams(1));
 
-		do
+		try
 		{
-			superblock.Store(bitMemory, dsrcChunk->rawStreamsInfo, dsrcChunk->compStreamsInfo, *fastqChunk);
-
-			bitMemory.Flush();
-			dsrcChunk->size = bitMemory.Position();
+			do
+			{
+				dsrcChunk->recordsCount = superblock.Store(bitMemory, dsrcChunk->rawStreamsInfo, dsrcChunk->compStreamsInfo, *fastqChunk);
 
-			writer->WriteNextChunk(dsrcChunk);
+				bitMemory.Flush();
+				dsrcChunk->size = bitMemory.Position();
 
-			if (args_.calculateCrc32)
-			{
-				BitMemoryReader reader(dsrcChunk->data.Pointer(), dsrcChunk->data.Size());
-				std::fill(fastqChunk->data.Pointer(), fastqChunk->data.Pointer() + fastqChunk->data.Size(), 0xCC);
+				writer->WriteNextChunk(dsrcChunk);
 
-				if (!superblock.VerifyChecksum(reader, *fastqChunk))
+				if (settings.calculateCrc32)
 				{
-					AddError("CRC32 checksums mismatch.");
-					break;
+					BitMemoryReader reader(dsrcChunk->data.Pointer(), dsrcChunk->data.Size());
+					std::fill(fastqChunk->data.Pointer(), fastqChunk->data.Pointer() + fastqChunk->data.Size(), 0xCC);
+
+					if (!superblock.VerifyChecksum(reader, *fastqChunk))
+					{
+						AddError("CRC32 checksums mismatch.");
+						break;
+					}
 				}
+
+				fastqChunk->Reset();
+				dsrcChunk->Reset();
+				bitMemory.Reset();
 			}
+			while (reader->ReadNextChunk(fastqChunk));
 
-			fastqChunk->Reset();
-			dsrcChunk->Reset();
-			bitMemory.Reset();
-		}
-		while (reader->ReadNextChunk(fastqChunk));
+			reader->Close();
 
-		reader->Close();
-		writer->FinishCompress();
+			// a failed append is rolled back below
+			//
+			if (!IsError() || !args_.appendArchive)
+				writer->FinishCompress();
+		}
+		catch (const std::exception& e_)
+		{
+			AddError(e_.what());
+		}
 
 
 		// set log
@@ -156,6 +306,8 @@ bool DsrcCompressorST::Process(const InputParameters &args_)
 	//
 	//
 
+	AbortCompress(writer);
+
 	TFree(writer);
 	TFree(reader);
 
@@ -180,38 +332,77 @@ bool DsrcDecompressorST::Process(const InputParameters& args_)
 	{
 		reader = new DsrcFileReader();
 		reader->StartDecompress(args_.inputFilename);
+		SetRecordsRange(*reader, args_);
 
 		if (args_.useFastqStdIo)
 			writer = new FastqStdIoWriter();
 		else
 			writer = new FastqFileWriter(args_.outputFilename);
 
+		// the blocks and models are given by the archive, nothing to scale down
+		//
+		CompressionSettings settings = reader->GetCompressionSettings();
+		MemoryPlan plan(1, 1, GetArchiveBlockSize(*reader, args_), (uint64)args_.memoryLimitMB << 20);
+		FitMemoryLimit(plan, settings, 0);
+		AddMemoryPlanLog(plan, settings);
+
 		dsrcChunk = new DsrcDataChunk(DsrcDataChunk::DefaultBufferSize);
 		fastqChunk = new FastqDataChunk(FastqDataChunk::DefaultBufferSize);
 	}
-	catch (const std::runtime_error& e_)
+	catch (const std::exception& e_)
 	{
 		AddError(e_.what());
 	}
 
 	if (!IsError())
 	{
-		BlockCompressor superblock(reader->GetDatasetType(), reader->GetCompressionSettings());
+		BlockCompressor superblock(reader->GetDatasetType(), reader->GetCompressionSettings(),
+								   BlockCompressor::UseParallelStreams(1));
 
-		while (reader->ReadNextChunk(dsrcChunk))
+		// reading sequential input can fail midway
+		//
+		try
 		{
-			BitMemoryReader bitMemory(dsrcChunk->data.Pointer(), dsrcChunk->size);
+			while (reader->ReadNextChunk(dsrcChunk))
+			{
+				BitMemoryReader bitMemory(dsrcChunk->data.Pointer(), dsrcChunk->size);
 
-			superblock.Read(bitMemory, *fastqChunk);
+				if (args_.outputFormat != OutputFormat::Fastq
+						|| dsrcChunk->firstRecord < args_.recordsBegin || dsrcChunk->firstRecord + dsrcChunk->recordsCount > args_.recordsEnd)
+				{
+					const uint64 begin = MAX(args_.recordsBegin, dsrcChunk->firstRecord);
+					superblock.Read(bitMemory, *fastqChunk, begin - dsrcChunk->firstRecord, args_.recordsEnd - begin,
+									args_.outputFormat);
+				}
+				else
+				{
+					superblock.Read(bitMemory, *fastqChunk);
+				}
 
-			writer->WriteNextChunk(fastqChunk);
+				writer->WriteNextChunk(fastqChunk);
 
-			fastqChunk->Reset();
-			dsrcChunk->Reset();
+				fastqChunk->Reset();
+				dsrcChunk->Reset();
+			}
+		}
+		catch (const std::exception& e_)
+		{
+			AddError(e_.what());
 		}
 
 		reader->FinishDecompress();
-		writer->Close();
+
+		// a failed write is reported only once
+		//
+		try
+		{
+			writer->Close();
+		}
+		catch (const std::exception& e_)
+		{
+			if (!IsError())
+				AddError(e_.what());
+		}
 	}
 
 	// make reusable
@@ -230,6 +421,7 @@ bool DsrcDecompressorST::Process(const InputParameters& args_)
 bool DsrcCompressorMT::Process(const InputParameters &args_)
 {
 	IFastqStreamReader* fileReader = NULL;
+	FastqGzipFileReader* gzipReader = NULL;
 	DsrcFileWriter* fileWriter = NULL;
 
 	// make reusable
@@ -238,6 +430,7 @@ bool DsrcCompressorMT::Process(const InputParameters &args_)
 	FastqDataQueue* fastqQueue = NULL;
 	DsrcDataPool* dsrcPool = NULL;
 	DsrcDataQueue* dsrcQueue = NULL;
+	DsrcDataQueue* verifyQueue = NULL;
 	ErrorHandler* errorHandler = NULL;
 	//
 	//
@@ -247,36 +440,112 @@ bool DsrcCompressorMT::Process(const InputParameters &args_)
 
 	FastqDatasetType datasetType;
 	CompressionSettings compSettings = GetCompressionSettings(args_);
+	uint32 threadsNum = args_.threadNum;
+	uint32 verifyThreadsNum = 0;
 
 	try
 	{
+		// the gzip members are inflated by separate threads, concurrently
+		// only in BGZF files
+		//
 		if (args_.useFastqStdIo)
+		{
 			fileReader = new FastqStdIoReader();
+		}
+		else if (GzipFileStreamReader::IsGzipFile(args_.inputFilename))
+		{
+			uint32 inflateThreadsNum = args_.ioThreadNum;
+			if (inflateThreadsNum == InputParameters::AutoIoThreadNum)
+				inflateThreadsNum = MAX(args_.threadNum / InputParameters::ProcessingThreadsPerInflateThread, 1);
+
+			fileReader = gzipReader = new FastqGzipFileReader(args_.inputFilename, inflateThreadsNum);
+		}
+		else if (MappedFileStreamReader::IsMappable(args_.inputFilename))
+		{
+			fileReader = new FastqMappedFileReader(args_.inputFilename);
+		}
 		else
+		{
 			fileReader = new FastqFileReader(args_.inputFilename);
+		}
 
 		fileWriter = new DsrcFileWriter();
-		fileWriter->StartCompress(args_.outputFilename);
+		if (args_.appendArchive)
+		{
+			fileWriter->StartAppend(args_.outputFilename);
+			compSettings = fileWriter->GetCompressionSettings();
+			compSettings.ransStreams = args_.ransStreams;		// chosen per block
+		}
+		else
+		{
+			fileWriter->StartCompress(args_.outputFilename, args_.streamedArchive);
+		}
 
-		const uint32 partNum = (args_.fastqBufferSizeMB < 128) ? args_.threadNum * 4 : args_.threadNum * 2;
-		fastqPool = new FastqDataPool(partNum, args_.fastqBufferSizeMB << 20);		// maxPart, bufferPartSize
-		fastqQueue = new FastqDataQueue(partNum, 1);								// maxPart, threadCount
+		uint32 adjustFlags = MemoryPlan::ADJUST_PARTS | MemoryPlan::ADJUST_BLOCK_SIZE | MemoryPlan::ADJUST_THREADS;
+		if (!args_.appendArchive)
+			adjustFlags |= MemoryPlan::ADJUST_MODELS;
 
-		dsrcPool = new DsrcDataPool(partNum, args_.fastqBufferSizeMB << 20);
-		dsrcQueue = new DsrcDataQueue(partNum, args_.threadNum);
+		// with CRC32 the compressed blocks are decoded again by the separate
+		// verifying threads before they are written
+		//
+		if (compSettings.calculateCrc32)
+		{
+			verifyThreadsNum = args_.verifyThreadNum;
+			if (verifyThreadsNum == InputParameters::AutoVerifyThreadNum)
+				verifyThreadsNum = MAX(args_.threadNum / InputParameters::ProcessingThreadsPerVerifyThread, 1);
+		}
 
-		if (args_.calculateCrc32)
-			errorHandler = new MultithreadedErrorHandler();
+		// a single reading thread does not keep up with many compressing
+		// ones in the fast modes, the files mapped in memory are then split
+		// into chunks by concurrent readers
+		//
+		uint32 ioThreadsNum = 1;
+		if (!fileReader->IsSequential())
+		{
+			ioThreadsNum = args_.ioThreadNum;
+			if (ioThreadsNum == InputParameters::AutoIoThreadNum)
+				ioThreadsNum = MAX(args_.threadNum / InputParameters::ProcessingThreadsPerIoThread, 1);
+		}
+		const uint32 ioPartNum = (ioThreadsNum > 1) ? ioThreadsNum : 0;
+
+		MemoryPlan plan(args_.threadNum, (args_.fastqBufferSizeMB < 128) ? 4 : 2,
+						(uint64)args_.fastqBufferSizeMB << 20, (uint64)args_.memoryLimitMB << 20, verifyThreadsNum,
+						ioPartNum);
+		if (gzipReader != NULL)
+			plan.inputBuffersSize = gzipReader->BuffersSize();
+		FitMemoryLimit(plan, compSettings, adjustFlags);
+		AddMemoryPlanLog(plan, compSettings);
+
+		threadsNum = plan.threadNum;
+		verifyThreadsNum = plan.verifyThreadNum;
+		const uint32 partNum = plan.PartNum();
+		fastqPool = new FastqDataPool(partNum + ioPartNum, plan.blockSize);		// maxPart, bufferPartSize
+		fastqQueue = new FastqDataQueue(partNum + ioPartNum, 1);				// maxPart, threadCount
+
+		dsrcPool = new DsrcDataPool(partNum, plan.blockSize);
+		if (verifyThreadsNum > 0)
+		{
+			verifyQueue = new DsrcDataQueue(partNum, threadsNum);
+			dsrcQueue = new DsrcDataQueue(partNum, verifyThreadsNum);
+		}
 		else
-			errorHandler = new ErrorHandler();
+		{
+			dsrcQueue = new DsrcDataQueue(partNum, threadsNum);
+		}
+
+		// every compressing thread can report an error
+		//
+		errorHandler = new MultithreadedErrorHandler();
 
-		dataReader = new FastqReader(*fileReader, *fastqQueue, *fastqPool, *errorHandler);
+		dataReader = new FastqReader(*fileReader, *fastqQueue, *fastqPool, *errorHandler, ioThreadsNum);
 		dataWriter = new DsrcWriter(*fileWriter, *dsrcQueue, *dsrcPool, *errorHandler);
 
-		// analyze file
+		// analyze file -- the appended records use the archive quality offset
 		//
-		const bool findQOffset = args_.qualityOffset == fq::FastqDatasetType::AutoQualityOffset;
-		if (!findQOffset)
+		const bool findQOffset = args_.qualityOffset == fq::FastqDatasetType::AutoQualityOffset && !args_.appendArchive;
+		if (args_.appendArchive)
+			datasetType.qualityOffset = fileWriter->GetDatasetType().qualityOffset;
+		else if (!findQOffset)
 			datasetType.qualityOffset = args_.qualityOffset;
 
 		if (!dataReader->AnalyzeFirstChunk(datasetType, findQOffset))
@@ -287,14 +556,18 @@ bool DsrcCompressorMT::Process(const InputParameters &args_)
 		fileWriter->SetDatasetType(datasetType);
 		fileWriter->SetCompressionSettings(compSettings);
 	}
-	catch (const std::runtime_error& e_)
+	catch (const std::exception& e_)
 	{
 		AddError(e_.what());
 	}
 
 	if (!IsError())
 	{
-		const uint32 threadsNum = args_.threadNum;
+		const bool parallelStreams = BlockCompressor::UseParallelStreams(threadsNum);
+
+		// the compressed blocks go to the writer through the verifiers, if any
+		//
+		DsrcDataQueue& compressedQueue = (verifyQueue != NULL) ? *verifyQueue : *dsrcQueue;
 
 		// launch threads
 		//
@@ -303,15 +576,26 @@ bool DsrcCompressorMT::Process(const InputParameters &args_)
 		std::vector<DsrcCompressor*> operators;
 		operators.resize(threadsNum);
 
+		std::vector<DsrcVerifier*> verifiers;
+		verifiers.resize(verifyThreadsNum);
+
 #ifdef USE_BOOST_THREAD
 		boost::thread_group opThreadGroup;		// why C++11 does not have thread_group? ://
 
 		for (uint32 i = 0; i < threadsNum; ++i)
 		{
-			operators[i] = new DsrcCompressor(*fastqQueue, *fastqPool, *dsrcQueue, *dsrcPool, *errorHandler, datasetType, compSettings);
+			operators[i] = new DsrcCompressor(*fastqQueue, *fastqPool, compressedQueue, *dsrcPool, *errorHandler, datasetType, compSettings,
+											parallelStreams);
 			opThreadGroup.create_thread(th::ref(*operators[i]));
 		}
 
+		for (uint32 i = 0; i < verifyThreadsNum; ++i)
+		{
+			verifiers[i] = new DsrcVerifier(*verifyQueue, *dsrcQueue, *dsrcPool, *errorHandler, datasetType, compSettings,
+											parallelStreams);
+			opThreadGroup.create_thread(th::ref(*verifiers[i]));
+		}
+
 		(*dataWriter)();			// main thread works as writer
 
 		readerThread.join();
@@ -322,10 +606,18 @@ bool DsrcCompressorMT::Process(const InputParameters &args_)
 
 		for (uint32 i = 0; i < threadsNum; ++i)
 		{
-			operators[i] = new DsrcCompressor(*fastqQueue, *fastqPool, *dsrcQueue, *dsrcPool, *errorHandler, datasetType, compSettings);
+			operators[i] = new DsrcCompressor(*fastqQueue, *fastqPool, compressedQueue, *dsrcPool, *errorHandler, datasetType, compSettings,
+											parallelStreams);
 			opThreadGroup.push_back(th::thread(th::ref(*operators[i])));
 		}
 
+		for (uint32 i = 0; i < verifyThreadsNum; ++i)
+		{
+			verifiers[i] = new DsrcVerifier(*verifyQueue, *dsrcQueue, *dsrcPool, *errorHandler, datasetType, compSettings,
+											parallelStreams);
+			opThreadGroup.push_back(th::thread(th::ref(*verifiers[i])));
+		}
+
 		(*dataWriter)();
 
 		readerThread.join();
@@ -349,14 +641,33 @@ bool DsrcCompressorMT::Process(const InputParameters &args_)
 		//
 		fastqQueue->Reset();
 		dsrcQueue->Reset();
+		if (verifyQueue != NULL)
+			verifyQueue->Reset();
 
 		for (uint32 i = 0; i < threadsNum; ++i)
 		{
 			delete operators[i];
 		}
 
+		for (uint32 i = 0; i < verifyThreadsNum; ++i)
+		{
+			delete verifiers[i];
+		}
+
 		fileReader->Close();
-		fileWriter->FinishCompress();
+
+		try
+		{
+			// a failed append is rolled back below
+			//
+			if (!IsError() || !args_.appendArchive)
+				fileWriter->FinishCompress();
+		}
+		catch (const std::exception& e_)
+		{
+			if (!IsError())
+				AddError(e_.what());
+		}
 
 
 		// set log
@@ -372,6 +683,7 @@ bool DsrcCompressorMT::Process(const InputParameters &args_)
 					  << " / " << std::setw(16) << rawSize.sizes[fq::StreamsInfo::DnaStream] << '\n';
 		ss << "QUA: " << std::setw(16) << compSize.sizes[fq::StreamsInfo::QualityStream]
 					  << " / " << std::setw(16) << rawSize.sizes[fq::StreamsInfo::QualityStream] << '\n';
+		WriteReorderStats(ss, dataWriter->GetReorderStats());
 		AddLog(ss.str());
 	}
 
@@ -381,6 +693,7 @@ bool DsrcCompressorMT::Process(const InputParameters &args_)
 
 	// make reusable
 	//
+	TFree(verifyQueue);
 	TFree(dsrcQueue);
 	TFree(dsrcPool);
 	TFree(fastqQueue);
@@ -388,6 +701,8 @@ bool DsrcCompressorMT::Process(const InputParameters &args_)
 	//
 	//
 
+	AbortCompress(fileWriter);
+
 	TFree(fileWriter);
 	TFree(fileReader);
 
@@ -414,35 +729,58 @@ bool DsrcDecompressorMT::Process(const InputParameters &args_)
 	DsrcReader* dataReader = NULL;
 	FastqWriter* dataWriter = NULL;
 
+	uint32 threadsNum = args_.threadNum;
+
 	try
 	{
 		fileReader = new DsrcFileReader();
 		fileReader->StartDecompress(args_.inputFilename);
+		SetRecordsRange(*fileReader, args_);
 
 		if (args_.useFastqStdIo)
 			fileWriter= new FastqStdIoWriter();
 		else
 			fileWriter = new FastqFileWriter(args_.outputFilename);
 
-		const uint32 partNum = (args_.fastqBufferSizeMB < 128) ? args_.threadNum * 4 : args_.threadNum * 2;
-		dsrcPool = new DsrcDataPool(partNum, args_.fastqBufferSizeMB << 20);
+		// a single reading thread does not keep up with many processing ones
+		// on fast storage, the blocks are then fetched by positional reads
+		//
+		// the blocks and models are given by the archive, only the parts
+		// in flight and the threads can be scaled down
+		//
+		// every reading thread holds a block of its own
+		//
+		uint32 ioThreadsNum = args_.ioThreadNum;
+		if (ioThreadsNum == InputParameters::AutoIoThreadNum)
+			ioThreadsNum = MAX(args_.threadNum / InputParameters::ProcessingThreadsPerIoThread, 1);
+
+		CompressionSettings settings = fileReader->GetCompressionSettings();
+		const uint64 blockSize = GetArchiveBlockSize(*fileReader, args_);
+		MemoryPlan plan(args_.threadNum, (blockSize < (128 << 20)) ? 4 : 2,
+						blockSize, (uint64)args_.memoryLimitMB << 20, 0, ioThreadsNum);
+		FitMemoryLimit(plan, settings, MemoryPlan::ADJUST_PARTS | MemoryPlan::ADJUST_THREADS);
+		AddMemoryPlanLog(plan, settings);
+
+		threadsNum = plan.threadNum;
+		const uint32 partNum = plan.PartNum();
+		dsrcPool = new DsrcDataPool(partNum + ioThreadsNum, plan.blockSize);
 		dsrcQueue = new DsrcDataQueue(partNum, 1);
 
 		fastqPool = new FastqDataPool(partNum, DsrcDataPool::DefaultBufferPartSize);		// maxPart, bufferPartSize
-		fastqQueue = new FastqDataQueue(partNum, args_.threadNum);						// maxPart, threadCount
+		fastqQueue = new FastqDataQueue(partNum, threadsNum);							// maxPart, threadCount
 
-		errorHandler = new ErrorHandler();
-		dataReader = new DsrcReader(*fileReader, *dsrcQueue, *dsrcPool, *errorHandler);
+		errorHandler = new MultithreadedErrorHandler();
+		dataReader = new DsrcReader(*fileReader, *dsrcQueue, *dsrcPool, *errorHandler, ioThreadsNum);
 		dataWriter = new FastqWriter(*fileWriter, *fastqQueue, *fastqPool, *errorHandler);
 	}
-	catch(const std::runtime_error& e_)
+	catch (const std::exception& e_)
 	{
 		AddError(e_.what());
 	}
 
 	if (!IsError())
 	{
-		const uint32 threadsNum = args_.threadNum;
+		const bool parallelStreams = BlockCompressor::UseParallelStreams(threadsNum);
 
 		// launch threads
 		//
@@ -458,7 +796,8 @@ bool DsrcDecompressorMT::Process(const InputParameters &args_)
 		for (uint32 i = 0; i < threadsNum; ++i)
 		{
 			operators[i] = new DsrcDecompressor(*fastqQueue, *fastqPool, *dsrcQueue, *dsrcPool, *errorHandler,
-												fileReader->GetDatasetType(), fileReader->GetCompressionSettings());
+												fileReader->GetDatasetType(), fileReader->GetCompressionSettings(),
+												args_.recordsBegin, args_.recordsEnd, args_.outputFormat, parallelStreams);
 			opThreadGroup.create_thread(th::ref(*operators[i]));
 		}
 
@@ -473,7 +812,8 @@ bool DsrcDecompressorMT::Process(const InputParameters &args_)
 		for (uint32 i = 0; i < threadsNum; ++i)
 		{
 			operators[i] = new DsrcDecompressor(*fastqQueue, *fastqPool, *dsrcQueue, *dsrcPool, *errorHandler,
-												fileReader->GetDatasetType(), fileReader->GetCompressionSettings());
+												fileReader->GetDatasetType(), fileReader->GetCompressionSettings(),
+												args_.recordsBegin, args_.recordsEnd, args_.outputFormat, parallelStreams);
 			opThreadGroup.push_back(th::thread(th::ref(*operators[i])));
 		}
 
@@ -487,6 +827,11 @@ bool DsrcDecompressorMT::Process(const InputParameters &args_)
 		}
 #endif
 
+		// check for errors
+		//
+		if (errorHandler->IsError())
+			AddError(errorHandler->GetError());
+
 		// free resources, cleanup
 		//
 		fastqQueue->Reset();
@@ -498,7 +843,22 @@ bool DsrcDecompressorMT::Process(const InputParameters &args_)
 		}
 
 		fileReader->FinishDecompress();
-		fileWriter->Close();
+
+		try
+		{
+			fileWriter->Close();
+		}
+		catch (const std::exception& e_)
+		{
+			if (!IsError())
+				AddError(e_.what());
+		}
+
+		// set log
+		//
+		std::ostringstream ss;
+		WriteReorderStats(ss, dataWriter->GetReorderStats());
+		AddLog(ss.str());
 	}
 
 	TFree(dataWriter);
@@ -520,6 +880,72 @@ bool DsrcDecompressorMT::Process(const InputParameters &args_)
 	return !IsError();
 }
 
+bool DsrcConcatenator::Process(const InputParameters& args_)
+{
+	ASSERT(!IsError());
+	ASSERT(inputFilenames.size() > 0);
+
+	DsrcFileWriter* writer = NULL;
+	DsrcFileReader* reader = NULL;
+
+	uint64 blocksCount = 0;
+	uint64 recordsCount = 0;
+
+	try
+	{
+		// blocks are copied without recompression, the archive settings
+		// are taken from the first one
+		//
+		writer = new DsrcFileWriter();
+		writer->StartCompress(args_.outputFilename, args_.streamedArchive);
+
+		for (uint32 i = 0; i < inputFilenames.size(); ++i)
+		{
+			reader = new DsrcFileReader();
+			reader->StartDecompress(inputFilenames[i]);
+
+			if (i == 0)
+			{
+				writer->SetDatasetType(reader->GetDatasetType());
+				writer->SetCompressionSettings(reader->GetCompressionSettings());
+			}
+
+			try
+			{
+				recordsCount += writer->CopyBlocks(*reader);
+			}
+			catch (const std::exception& e_)
+			{
+				throw DsrcException((inputFilenames[i] + ": " + e_.what()).c_str());
+			}
+
+			reader->FinishDecompress();
+			delete reader;
+			reader = NULL;
+		}
+
+		blocksCount = writer->BlockCount();
+		writer->FinishCompress();
+	}
+	catch (const std::exception& e_)
+	{
+		AddError(e_.what());
+	}
+
+	if (!IsError())
+	{
+		std::ostringstream ss;
+		ss << "Concatenated archives: " << inputFilenames.size() << '\n';
+		ss << "Blocks: " << blocksCount << ", records: " << recordsCount << '\n';
+		AddLog(ss.str());
+	}
+
+	TFree(reader);
+	TFree(writer);
+
+	return !IsError();
+}
+
 } // namespace comp
 
 } // namespace dsrc
@@ -13,6 +13,7 @@
 #include "../include/dsrc/Globals.h"
 
 #include <string>
+#include <vector>
 
 #include "FastqStream.h"
 #include "DsrcFile.h"
@@ -23,6 +24,65 @@ namespace dsrc
 namespace comp
 {
 
+// Memory used by the processing pipeline: the FASTQ and DSRC parts in flight,
+// the compressors of the processing and verifying threads and the input and output buffers
+//
+struct MemoryPlan
+{
+	enum AdjustFlags
+	{
+		ADJUST_PARTS		= BIT(0),
+		ADJUST_BLOCK_SIZE	= BIT(1),
+		ADJUST_MODELS		= BIT(2),		// lower the models order, not possible when appending
+		ADJUST_THREADS		= BIT(3)
+	};
+
+	static const uint32 MinPartsPerThread = 2;
+	static const uint64 MinBlockSize = 1 << 20;
+
+	uint32 threadNum;
+	uint32 verifyThreadNum;
+	uint32 ioThreadNum;				// parallel readers, each holding a part of its own
+	uint32 partsPerThread;
+	uint64 blockSize;
+
+	uint64 poolsSize;
+	uint64 compressorsSize;
+	uint64 buffersSize;
+	uint64 inputBuffersSize;		// data read ahead by the input stream, e.g. inflated gzip
+
+	uint64 limit;
+
+	MemoryPlan(uint32 threadNum_, uint32 partsPerThread_, uint64 blockSize_, uint64 limit_, uint32 verifyThreadNum_ = 0,
+			   uint32 ioThreadNum_ = 0)
+		:	threadNum(threadNum_)
+		,	verifyThreadNum(verifyThreadNum_)
+		,	ioThreadNum(ioThreadNum_)
+		,	partsPerThread(partsPerThread_)
+		,	blockSize(blockSize_)
+		,	poolsSize(0)
+		,	compressorsSize(0)
+		,	buffersSize(0)
+		,	inputBuffersSize(0)
+		,	limit(limit_)
+	{}
+
+	uint32 PartNum() const
+	{
+		return threadNum * partsPerThread;
+	}
+
+	uint64 TotalSize() const
+	{
+		return poolsSize + compressorsSize + buffersSize;
+	}
+
+	bool FitsLimit() const
+	{
+		return limit == 0 || TotalSize() <= limit;
+	}
+};
+
 class IDsrcOperator
 {
 public:
@@ -85,9 +145,58 @@ protected:
 
 		settings.tagPreserveFlags = args_.tagPreserveFlags;
 		settings.calculateCrc32 = args_.calculateCrc32;
+		settings.ransStreams = args_.ransStreams;
 
 		return settings;
 	}
+
+	static void SetRecordsRange(DsrcFileReader& reader_, const InputParameters& args_)
+	{
+		if (!args_.IsRecordsRangeSet())
+			return;
+
+		// archives stored without the records index need to have it
+		// computed from the blocks headers, sequential input is filtered
+		// while reading
+		if (!reader_.HasRecordsIndex() && !reader_.IsSequential())
+			reader_.ComputeRecordsIndex();
+
+		reader_.SetRecordsRange(args_.recordsBegin, args_.recordsEnd);
+	}
+
+	// the blocks of an archive being decompressed, the block size option
+	// is used only when they are not known in advance
+	//
+	static uint64 GetArchiveBlockSize(const DsrcFileReader& reader_, const InputParameters& args_)
+	{
+		const uint64 size = reader_.MaxBlockBufferSize();
+		return size != 0 ? size : (uint64)args_.fastqBufferSizeMB << 20;
+	}
+
+	// closes the archive left open by an error, an appended archive is restored
+	//
+	void AbortCompress(DsrcFileWriter* writer_)
+	{
+		if (writer_ == NULL || !IsError())
+			return;
+
+		try
+		{
+			writer_->AbortCompress();
+		}
+		catch (const std::exception& e_)
+		{
+			AddError(e_.what());
+		}
+	}
+
+	// scales the pipeline down step by step until it fits the memory limit,
+	// the plan is left at its smallest if the limit cannot be met
+	//
+	static void FitMemoryLimit(MemoryPlan& plan_, CompressionSettings& settings_, uint32 adjustFlags_);
+	static void EstimateMemory(MemoryPlan& plan_, const CompressionSettings& settings_);
+
+	void AddMemoryPlanLog(const MemoryPlan& plan_, const CompressionSettings& settings_);
 };
 
 class DsrcCompressorST : public IDsrcOperator
@@ -114,6 +223,19 @@ public:
 	bool Process(const InputParameters& args_);
 };
 
+class DsrcConcatenator : public IDsrcOperator
+{
+public:
+	DsrcConcatenator(const std::vector<std::string>& inputFilenames_)
+		:	inputFilenames(inputFilenames_)
+	{}
+
+	bool Process(const InputParameters& args_);
+
+private:
+	const std::vector<std::string> inputFilenames;
+};
+
 } // namespace comp
 
 } // namespace dsrc
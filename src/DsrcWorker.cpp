@@ -34,41 +34,94 @@ void DsrcCompressor::Process()
 	FastqDataChunk* fqChunk = NULL;
 	DsrcDataChunk* dsrcData = NULL;
 
-	BlockCompressor superblock(datasetType, compSettings);
+	BlockCompressor superblock(datasetType, compSettings, parallelStreams);
 
-	while (!errorHandler.IsError() && fastqQueue.Pop(partId, fqChunk))
+	try
 	{
-		ASSERT(fqChunk->size > 0);
+		while (!errorHandler.IsError() && fastqQueue.Pop(partId, fqChunk))
+		{
+			ASSERT(fqChunk->size > 0);
+
+			dsrcPool.Acquire(dsrcData);
+			ASSERT(dsrcData != NULL);
+
+			BitMemoryWriter bitMemory(dsrcData->data);
+
+			dsrcData->recordsCount = superblock.Store(bitMemory, dsrcData->rawStreamsInfo, dsrcData->compStreamsInfo, *fqChunk);
+
+			bitMemory.Flush();
+			dsrcData->size = bitMemory.Position();
+
+			dsrcQueue.Push(partId, dsrcData);
+			dsrcData = NULL;
+			bitMemory.Reset();
+
+			fastqPool.Release(fqChunk);
+			fqChunk = NULL;
+		}
+	}
+	catch (const std::exception& e_)
+	{
+		errorHandler.SetError(e_.what());
 
-		dsrcPool.Acquire(dsrcData);
-		ASSERT(dsrcData != NULL);
+		if (dsrcData != NULL)
+			dsrcPool.Release(dsrcData);
+		if (fqChunk != NULL)
+			fastqPool.Release(fqChunk);
+	}
+
+	// after an error the chunks are only released, unblocking the reader
+	//
+	while (fastqQueue.Pop(partId, fqChunk))
+		fastqPool.Release(fqChunk);
+
+	dsrcQueue.SetCompleted();
+}
 
-		BitMemoryWriter bitMemory(dsrcData->data);
+void DsrcVerifier::Process()
+{
+	int64 partId = 0;
 
-		superblock.Store(bitMemory, dsrcData->rawStreamsInfo, dsrcData->compStreamsInfo, *fqChunk);
+	DsrcDataChunk* dsrcData = NULL;
+	FastqDataChunk fqChunk(FastqDataChunk::DefaultBufferSize);
 
-		bitMemory.Flush();
-		dsrcData->size = bitMemory.Position();
+	BlockCompressor superblock(datasetType, compSettings, parallelStreams);
 
-		if (compSettings.calculateCrc32)
+	try
+	{
+		while (!errorHandler.IsError() && verifyQueue.Pop(partId, dsrcData))
 		{
+			ASSERT(dsrcData->size > 0);
+
 			BitMemoryReader reader(dsrcData->data.Pointer(), dsrcData->data.Size());
-			std::fill(fqChunk->data.Pointer(), fqChunk->data.Pointer() + fqChunk->data.Size(), 0xCC);
+			std::fill(fqChunk.data.Pointer(), fqChunk.data.Pointer() + fqChunk.data.Size(), 0xCC);
 
-			if (!superblock.VerifyChecksum(reader, *fqChunk))
+			if (!superblock.VerifyChecksum(reader, fqChunk))
 			{
 				errorHandler.SetError("CRC32 checksums mismatch.");
+				dsrcPool.Release(dsrcData);
+				dsrcData = NULL;
+				break;
 			}
-		}
 
-		dsrcQueue.Push(partId, dsrcData);
-		dsrcData = NULL;
-		bitMemory.Reset();
+			dsrcQueue.Push(partId, dsrcData);
+			dsrcData = NULL;
+		}
+	}
+	catch (const std::exception& e_)
+	{
+		errorHandler.SetError(e_.what());
 
-		fastqPool.Release(fqChunk);
-		fqChunk = NULL;
+		if (dsrcData != NULL)
+			dsrcPool.Release(dsrcData);
 	}
 
+	// after an error the blocks are only released, unblocking the
+	// compressing threads waiting for the parts
+	//
+	while (verifyQueue.Pop(partId, dsrcData))
+		dsrcPool.Release(dsrcData);
+
 	dsrcQueue.SetCompleted();
 }
 
@@ -79,26 +132,52 @@ void DsrcDecompressor::Process()
 	FastqDataChunk* fqChunk = NULL;
 	DsrcDataChunk* dsrcData = NULL;
 
-	BlockCompressor superblock(datasetType, compSettings);
+	BlockCompressor superblock(datasetType, compSettings, parallelStreams);
 
-	while (!errorHandler.IsError() && dsrcQueue.Pop(partId, dsrcData))
+	try
 	{
-		ASSERT(dsrcData);
-		ASSERT(dsrcData->size > 0);
-		ASSERT(dsrcData->size <= dsrcData->data.Size());
+		while (!errorHandler.IsError() && dsrcQueue.Pop(partId, dsrcData))
+		{
+			ASSERT(dsrcData);
+			ASSERT(dsrcData->size > 0);
+			ASSERT(dsrcData->size <= dsrcData->data.Size());
+
+			BitMemoryReader bitMemory(dsrcData->data.Pointer(), dsrcData->size);
 
-		BitMemoryReader bitMemory(dsrcData->data.Pointer(), dsrcData->size);
+			fastqPool.Acquire(fqChunk);
 
-		fastqPool.Acquire(fqChunk);
+			if (outputFormat != OutputFormat::Fastq
+					|| dsrcData->firstRecord < recordsBegin || dsrcData->firstRecord + dsrcData->recordsCount > recordsEnd)
+			{
+				const uint64 begin = MAX(recordsBegin, dsrcData->firstRecord);
+				superblock.Read(bitMemory, *fqChunk, begin - dsrcData->firstRecord, recordsEnd - begin, outputFormat);
+			}
+			else
+			{
+				superblock.Read(bitMemory, *fqChunk);
+			}
+
+			fastqQueue.Push(partId, fqChunk);
+			fqChunk = NULL;
 
-		superblock.Read(bitMemory, *fqChunk);
+			dsrcPool.Release(dsrcData);
+			dsrcData = NULL;
+		}
+	}
+	catch (const std::exception& e_)
+	{
+		errorHandler.SetError(e_.what());
 
-		fastqQueue.Push(partId, fqChunk);
-		fqChunk = NULL;
+		if (fqChunk != NULL)
+			fastqPool.Release(fqChunk);
+		if (dsrcData != NULL)
+			dsrcPool.Release(dsrcData);
+	}
 
+	// after an error the blocks are only released, unblocking the reader
+	//
+	while (dsrcQueue.Pop(partId, dsrcData))
 		dsrcPool.Release(dsrcData);
-		dsrcData = NULL;
-	}
 
 	fastqQueue.SetCompleted();
 }
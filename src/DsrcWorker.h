@@ -31,7 +31,8 @@ class IDsrcThreadWorker
 public:
 	IDsrcThreadWorker(fq::FastqDataQueue& fastqQueue_, fq::FastqDataPool& fastqPool_,
 				   DsrcDataQueue& dsrcQueue_, DsrcDataPool& dsrcPool_, core::ErrorHandler& errorHandler_,
-				   const fq::FastqDatasetType& type_, const CompressionSettings& settings_)
+				   const fq::FastqDatasetType& type_, const CompressionSettings& settings_,
+				   bool parallelStreams_ = false)
 		:	fastqQueue(fastqQueue_)
 		,	fastqPool(fastqPool_)
 		,	dsrcQueue(dsrcQueue_)
@@ -39,6 +40,7 @@ public:
 		,	errorHandler(errorHandler_)
 		,	datasetType(type_)
 		,	compSettings(settings_)
+		,	parallelStreams(parallelStreams_)
 	{}
 
 	virtual ~IDsrcThreadWorker() {}
@@ -57,6 +59,7 @@ protected:
 
 	fq::FastqDatasetType datasetType;
 	CompressionSettings compSettings;
+	const bool parallelStreams;
 
 private:
 	virtual void Process() = 0;
@@ -67,8 +70,10 @@ class DsrcCompressor : public IDsrcThreadWorker
 public:
 	DsrcCompressor(fq::FastqDataQueue& fastqQueue_, fq::FastqDataPool& fastqPool_,
 				   DsrcDataQueue& dsrcQueue_, DsrcDataPool& dsrcPool_, core::ErrorHandler& errorHandler_,
-				   const fq::FastqDatasetType& type_, const CompressionSettings& settings_)
-		:	IDsrcThreadWorker(fastqQueue_, fastqPool_, dsrcQueue_, dsrcPool_, errorHandler_, type_, settings_)
+				   const fq::FastqDatasetType& type_, const CompressionSettings& settings_,
+				   bool parallelStreams_ = false)
+		:	IDsrcThreadWorker(fastqQueue_, fastqPool_, dsrcQueue_, dsrcPool_, errorHandler_, type_, settings_,
+							  parallelStreams_)
 	{}
 
 private:
@@ -76,16 +81,64 @@ private:
 };
 
 
+// Checks the blocks compressed with CRC32 by decoding them again, passing
+// on only the verified ones -- run as a separate stage, so the compressing
+// threads release their FASTQ parts as soon as the blocks are stored
+//
+class DsrcVerifier
+{
+public:
+	DsrcVerifier(DsrcDataQueue& verifyQueue_, DsrcDataQueue& dsrcQueue_, DsrcDataPool& dsrcPool_,
+				 core::ErrorHandler& errorHandler_, const fq::FastqDatasetType& type_,
+				 const CompressionSettings& settings_, bool parallelStreams_ = false)
+		:	verifyQueue(verifyQueue_)
+		,	dsrcQueue(dsrcQueue_)
+		,	dsrcPool(dsrcPool_)
+		,	errorHandler(errorHandler_)
+		,	datasetType(type_)
+		,	compSettings(settings_)
+		,	parallelStreams(parallelStreams_)
+	{}
+
+	void operator() ()
+	{
+		Process();
+	}
+
+private:
+	DsrcDataQueue& verifyQueue;
+	DsrcDataQueue& dsrcQueue;
+	DsrcDataPool& dsrcPool;
+	core::ErrorHandler&	errorHandler;
+
+	fq::FastqDatasetType datasetType;
+	CompressionSettings compSettings;
+	const bool parallelStreams;
+
+	void Process();
+};
+
+
 class DsrcDecompressor : public IDsrcThreadWorker
 {
 public:
 	DsrcDecompressor(fq::FastqDataQueue& fastqQueue_, fq::FastqDataPool& fastqPool_,
 					DsrcDataQueue& dsrcQueue_, DsrcDataPool& dsrcPool_, core::ErrorHandler& errorHandler_,
-					const fq::FastqDatasetType& type_, const CompressionSettings& settings_)
-		:	IDsrcThreadWorker(fastqQueue_, fastqPool_, dsrcQueue_, dsrcPool_, errorHandler_, type_, settings_)
+					const fq::FastqDatasetType& type_, const CompressionSettings& settings_,
+					uint64 recordsBegin_ = 0, uint64 recordsEnd_ = InputParameters::DefaultRecordsEnd,
+					OutputFormat::FormatEnum outputFormat_ = OutputFormat::Fastq, bool parallelStreams_ = false)
+		:	IDsrcThreadWorker(fastqQueue_, fastqPool_, dsrcQueue_, dsrcPool_, errorHandler_, type_, settings_,
+							  parallelStreams_)
+		,	recordsBegin(recordsBegin_)
+		,	recordsEnd(recordsEnd_)
+		,	outputFormat(outputFormat_)
 	{}
 
 private:
+	const uint64 recordsBegin;
+	const uint64 recordsEnd;
+	const OutputFormat::FormatEnum outputFormat;
+
 	void Process();
 };
 
@@ -10,13 +10,19 @@
 #include "FastqIo.h"
 
 #include <vector>
-#include <map>
 
 #include "Buffer.h"
 #include "FastqStream.h"
 #include "FastqParser.h"
 #include "ErrorHandler.h"
 
+#ifdef USE_BOOST_THREAD
+#include <boost/thread.hpp>
+#include <boost/bind.hpp>
+#else
+#include <thread>
+#endif
+
 namespace dsrc
 {
 
@@ -29,8 +35,21 @@ bool FastqReader::AnalyzeFirstChunk(FastqDatasetType& header_, bool estimateQual
 	FastqDataChunk* fqChunk;
 	recordsPool.Acquire(fqChunk);
 
+	// the chunks read in parallel are split independently from the sequential ones
+	//
+	bool read;
+	if (IsParallel())
+	{
+		fileReader.ReadChunkAt(0, recordsPool.BufferPartSize(), fqChunk);
+		read = fqChunk->size > 0;
+	}
+	else
+	{
+		read = fileReader.ReadNextChunk(fqChunk);
+	}
+
 	// analyze first chunk
-	if (!fileReader.ReadNextChunk(fqChunk) || !parser.Analyze(*fqChunk, header_, estimateQualityOffset_))
+	if (!read || !parser.Analyze(*fqChunk, header_, estimateQualityOffset_))
 	{
 		recordsPool.Release(fqChunk);
 		return false;
@@ -45,26 +64,114 @@ bool FastqReader::AnalyzeFirstChunk(FastqDatasetType& header_, bool estimateQual
 
 void FastqReader::operator()()
 {
+	// only the files mapped in memory can be read concurrently
+	//
+	if (IsParallel())
+	{
+		chunkCount = fileReader.ChunkCount(recordsPool.BufferPartSize());
+		nextChunkId = numParts;
+		nextPushChunkId = numParts;
+
+#ifdef USE_BOOST_THREAD
+		boost::thread_group ioThreadGroup;
+		for (uint32 i = 0; i < ioThreadsNum; ++i)
+			ioThreadGroup.create_thread(boost::bind(&FastqReader::ReadChunks, this));
+		ioThreadGroup.join_all();
+#else
+		std::vector<th::thread> ioThreadGroup;
+		for (uint32 i = 0; i < ioThreadsNum; ++i)
+			ioThreadGroup.push_back(th::thread(&FastqReader::ReadChunks, this));
+		for (th::thread& t : ioThreadGroup)
+			t.join();
+#endif
+
+		recordsQueue.SetCompleted();
+		return;
+	}
+
 	FastqDataChunk* part = NULL;
 
 	recordsPool.Acquire(part);
 
-	while (!errorHandler.IsError() && fileReader.ReadNextChunk(part))
+	// the streams decompressing the input report the corrupted data
+	//
+	try
 	{
-		ASSERT(part->size > 0);
+		while (!errorHandler.IsError() && fileReader.ReadNextChunk(part))
+		{
+			ASSERT(part->size > 0);
 
-		recordsQueue.Push(numParts, part);
-		numParts++;
+			recordsQueue.Push(numParts, part);
+			numParts++;
 
-		recordsPool.Acquire(part);
+			recordsPool.Acquire(part);
+		}
+	}
+	catch (const std::exception& e_)
+	{
+		errorHandler.SetError(e_.what());
 	}
 
-	ASSERT(part->size == 0);
-	recordsPool.Release(part);		// the last empty part
+	recordsPool.Release(part);		// the last part, empty unless failed
 
 	recordsQueue.SetCompleted();
 }
 
+void FastqReader::ReadChunks()
+{
+	FastqDataChunk* part = NULL;
+
+	try
+	{
+		for ( ;; )
+		{
+			recordsPool.Acquire(part);
+
+			uint64 chunkId = 0;
+			{
+				th::lock_guard<th::mutex> lock(claimMutex);
+				if (errorHandler.IsError() || nextChunkId == chunkCount)
+					break;
+				chunkId = nextChunkId++;
+			}
+
+			fileReader.ReadChunkAt(chunkId, recordsPool.BufferPartSize(), part);
+			ASSERT(part->size > 0);
+
+			// keeping the queue in the file order bounds the reordering done
+			// after compression, as with a single reader
+			//
+			th::unique_lock<th::mutex> lock(pushMutex);
+			while (nextPushChunkId != chunkId && !errorHandler.IsError())
+				pushCondition.wait(lock);
+
+			// the readers waiting for their turn are woken up to stop too
+			//
+			if (errorHandler.IsError())
+			{
+				pushCondition.notify_all();
+				break;
+			}
+
+			recordsQueue.Push(chunkId, part);
+			part = NULL;
+
+			nextPushChunkId++;
+			pushCondition.notify_all();
+		}
+	}
+	catch (const std::exception& e_)
+	{
+		errorHandler.SetError(e_.what());
+
+		th::lock_guard<th::mutex> lock(pushMutex);
+		pushCondition.notify_all();
+	}
+
+	if (part != NULL)
+		recordsPool.Release(part);
+}
+
 
 // FastqWriter
 //
@@ -72,66 +179,50 @@ void FastqWriter::operator()()
 {
 	FastqDataChunk* part = NULL;
 	int64 partId = 0;
-	int64 lastPartId = -1;
 
-	std::map<int64, FastqDataChunk*> partsQueue;
+	core::TReorderBuffer<FastqDataChunk> partsQueue(recordsPool.MaxPartNum());
 
-	while (!errorHandler.IsError() && recordsQueue.Pop(partId, part))
+	// a failed write stops writing, the remaining parts are only
+	// released to unblock the decompressing threads
+	//
+	try
 	{
-		ASSERT(part->size > 0);
-		std::vector<FastqRecord>::const_iterator i;
-
-		if (partId != lastPartId + 1)
+		while (!errorHandler.IsError() && recordsQueue.Pop(partId, part))
 		{
-			ASSERT(partsQueue.count(partId) == 0);
-			partsQueue.insert(std::make_pair(partId, part));
-			continue;
-		}
+			ASSERT(part->size > 0);
 
-		fileWriter.WriteNextChunk(part);
-		lastPartId++;
+			partsQueue.Push(partId, part);
+			part = NULL;
 
-		recordsPool.Release(part);
-		part = NULL;
-
-		while (partsQueue.size() > 0)
-		{
-			if (partsQueue.begin()->first == lastPartId + 1)
+			while (!errorHandler.IsError() && partsQueue.Pop(part))
 			{
-				part = partsQueue.begin()->second;
 				fileWriter.WriteNextChunk(part);
-				lastPartId++;
 
 				recordsPool.Release(part);
-				partsQueue.erase(partsQueue.begin());
-			}
-			else
-			{
-				break;
+				part = NULL;
 			}
 		}
-
-		part = NULL;
+	}
+	catch (const std::exception& e_)
+	{
+		errorHandler.SetError(e_.what());
 	}
 
-	while (!errorHandler.IsError() && partsQueue.size() > 0)
+	if (errorHandler.IsError())
 	{
-		if (partsQueue.begin()->first == lastPartId + 1)
-		{
-			part = partsQueue.begin()->second;
-			fileWriter.WriteNextChunk(part);
-			lastPartId++;
+		if (part != NULL)
+			recordsPool.Release(part);
 
+		while (partsQueue.Drain(part))
+			recordsPool.Release(part);
+
+		while (recordsQueue.Pop(partId, part))
 			recordsPool.Release(part);
-			partsQueue.erase(partsQueue.begin());
-		}
-		else
-		{
-			break;
-		}
 	}
 
-	ASSERT(errorHandler.IsError() || partsQueue.size() == 0);
+	reorderStats = partsQueue.GetStats();
+
+	ASSERT(errorHandler.IsError() || partsQueue.IsEmpty());
 }
 
 } // namesapce fq
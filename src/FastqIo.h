@@ -16,6 +16,7 @@
 #include "Fastq.h"
 #include "DataQueue.h"
 #include "DataPool.h"
+#include "ReorderBuffer.h"
 #include "FastqStream.h"
 
 namespace dsrc
@@ -52,10 +53,15 @@ protected:
 class FastqReader : public IFastqIoOperator
 {
 public:
-	FastqReader(IFastqStreamReader& reader_, FastqDataQueue& queue_, FastqDataPool& pool_, core::ErrorHandler& errorHandler_)
+	FastqReader(IFastqStreamReader& reader_, FastqDataQueue& queue_, FastqDataPool& pool_, core::ErrorHandler& errorHandler_,
+				uint32 ioThreadsNum_ = 1)
 		:	IFastqIoOperator(queue_, pool_, errorHandler_)
 		,	fileReader(reader_)
+		,	ioThreadsNum(ioThreadsNum_)
 		,	numParts(0)
+		,	chunkCount(0)
+		,	nextChunkId(0)
+		,	nextPushChunkId(0)
 	{}
 
 	bool AnalyzeFirstChunk(FastqDatasetType& header_, bool estimateQualityOffset_);
@@ -63,7 +69,25 @@ public:
 
 private:
 	IFastqStreamReader&	fileReader;
+	const uint32 ioThreadsNum;
 	uint32 numParts;
+
+	// parallel mode: the chunks are claimed in order, their boundaries found
+	// and read concurrently and pushed to the queue in order
+	uint64 chunkCount;
+	uint64 nextChunkId;
+	uint64 nextPushChunkId;
+
+	th::mutex claimMutex;
+	th::mutex pushMutex;
+	th::condition_variable pushCondition;
+
+	bool IsParallel() const
+	{
+		return ioThreadsNum > 1 && !fileReader.IsSequential();
+	}
+
+	void ReadChunks();
 };
 
 class FastqWriter : public IFastqIoOperator
@@ -76,8 +100,14 @@ public:
 
 	void operator()();
 
+	const core::ReorderStats& GetReorderStats() const
+	{
+		return reorderStats;
+	}
+
 private:
 	IFastqStreamWriter&	fileWriter;
+	core::ReorderStats reorderStats;
 };
 
 } // namespace fq
@@ -14,6 +14,7 @@
 
 #include "Common.h"
 #include "Fastq.h"
+#include "LineScanner.h"
 
 namespace dsrc
 {
@@ -92,24 +93,14 @@ protected:
 
 	uint32 SkipLine()
 	{
-		uint32 len = 0;
-		for (;;)
-		{
-			int32 c = Getc();
-			if (c == -1)
-				break;
-
-			if (c != '\n' && c != '\r')
-			{
-				len++;
-			}
-			else
-			{
-				if (c == '\r' && Peekc() == '\n')	// case of CR LF
-					Skipc();
+		const uint64 eol = FindLineEnd(memory, memoryPos, memorySize);
+		const uint32 len = (uint32)(eol - memoryPos);
 
-				break;
-			}
+		memoryPos = eol;
+		if (memoryPos < memorySize)
+		{
+			if (memory[memoryPos++] == '\r' && Peekc() == '\n')	// case of CR LF
+				Skipc();
 		}
 		return len;
 	}
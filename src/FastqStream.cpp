@@ -45,7 +45,7 @@ bool IFastqStreamReader::ReadNextChunk(FastqDataChunk* chunk_)
 		{
 			uint64 chunkEnd = cbufSize - SwapBufferSize;
 
-			chunkEnd = GetNextRecordPos(data, chunkEnd, cbufSize);
+			chunkEnd = GetNextRecordPos(data, chunkEnd, cbufSize, usesCrlf);
 
 			chunk_->size = chunkEnd - 1;
 			if (usesCrlf)
@@ -71,26 +71,122 @@ bool IFastqStreamReader::ReadNextChunk(FastqDataChunk* chunk_)
 	return true;
 }
 
-uint64 IFastqStreamReader::GetNextRecordPos(uchar* data_, uint64 pos_, const uint64 size_)
+bool FastqMappedFileReader::ReadNextChunk(FastqDataChunk* chunk_)
 {
-	SkipToEol(data_, pos_, size_);
+	if (Eof())
+	{
+		chunk_->size = 0;
+		return false;
+	}
+
+	const uchar* data = mappedStream->Pointer();
+	const uint64 pos = mappedStream->Position();
+	const uint64 cbufSize = chunk_->data.Size();
+	const uint64 left = mappedStream->Size() - pos;
+
+	uint64 chunkEnd;
+	if (left > cbufSize)	// somewhere before end
+	{
+		chunkEnd = GetNextRecordPos(data + pos, cbufSize - SwapBufferSize, cbufSize, usesCrlf);
+
+		chunk_->size = chunkEnd - 1;
+		if (usesCrlf)
+			chunk_->size -= 1;
+
+		// start loading the next chunk while this one is processed
+		//
+		mappedStream->AdviseWillNeed(pos + chunkEnd, cbufSize);
+	}
+	else					// at the end of file
+	{
+		chunkEnd = left;
+
+		chunk_->size = left - 1;	// skip the last EOF symbol
+		if (usesCrlf)
+			chunk_->size -= 1;
+
+		eof = true;
+	}
+
+	std::copy(data + pos, data + pos + chunkEnd, chunk_->data.Pointer());
+	mappedStream->SetPosition(pos + chunkEnd);
+
+	// the consumed data is not accessed again
+	//
+	mappedStream->AdviseDontNeed(pos, chunkEnd);
+
+	return true;
+}
+
+uint64 FastqMappedFileReader::ChunkCount(uint64 bufferSize_) const
+{
+	ASSERT(bufferSize_ > SwapBufferSize);
+
+	// the next range is started only when more than the swap buffer is
+	// left after its nominal beginning, as in the sequential reading
+	//
+	const uint64 size = mappedStream->Size();
+	if (size <= SwapBufferSize)
+		return 1;
+	return (size - SwapBufferSize - 1) / (bufferSize_ - SwapBufferSize) + 1;
+}
+
+uint64 FastqMappedFileReader::ChunkBegin(uint64 chunkId_, uint64 bufferSize_) const
+{
+	if (chunkId_ == 0)
+		return 0;
+
+	if (chunkId_ == ChunkCount(bufferSize_))
+		return mappedStream->Size();
+
+	bool crlf = false;
+	return GetNextRecordPos(mappedStream->Pointer(), chunkId_ * (bufferSize_ - SwapBufferSize),
+							mappedStream->Size(), crlf);
+}
+
+void FastqMappedFileReader::ReadChunkAt(uint64 chunkId_, uint64 bufferSize_, FastqDataChunk* chunk_) const
+{
+	ASSERT(chunkId_ < ChunkCount(bufferSize_));
+	ASSERT(chunk_->data.Size() >= bufferSize_);
+
+	// the neighbouring chunks find their common boundary independently
+	//
+	const uchar* data = mappedStream->Pointer();
+	const uint64 begin = ChunkBegin(chunkId_, bufferSize_);
+	const uint64 end = ChunkBegin(chunkId_ + 1, bufferSize_);
+	ASSERT(end - begin <= bufferSize_);
+
+	chunk_->size = end - begin - 1;		// skip the last EOL symbol
+	if (chunk_->size > 0 && data[end - 2] == '\r')
+		chunk_->size -= 1;
+
+	std::copy(data + begin, data + end, chunk_->data.Pointer());
+
+	// the consumed data is not accessed again, except for the boundaries
+	//
+	mappedStream->AdviseDontNeed(begin, end - begin);
+}
+
+uint64 IFastqStreamReader::GetNextRecordPos(const uchar* data_, uint64 pos_, const uint64 size_, bool& usesCrlf_)
+{
+	SkipToEol(data_, pos_, size_, usesCrlf_);
 	++pos_;
 
 	// find beginning of the next record
 	while (data_[pos_] != '@')
 	{
-		SkipToEol(data_, pos_, size_);
+		SkipToEol(data_, pos_, size_, usesCrlf_);
 		++pos_;
 	}
 	uint64 pos0 = pos_;
 
-	SkipToEol(data_, pos_, size_);
+	SkipToEol(data_, pos_, size_, usesCrlf_);
 	++pos_;
 
 	if (data_[pos_] == '@')			// previous one was a quality field
 		return pos_;
 
-	SkipToEol(data_, pos_, size_);
+	SkipToEol(data_, pos_, size_, usesCrlf_);
 	++pos_;
 
 	ASSERT(data_[pos_] == '+');	// pos0 was the start of tag
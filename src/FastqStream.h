@@ -13,8 +13,11 @@
 
 //#include "Common.h"
 #include "Fastq.h"
+#include "LineScanner.h"
 #include "Buffer.h"
 #include "FileStream.h"
+#include "AsyncFileStream.h"
+#include "GzipFileStream.h"
 #include "StdStream.h"
 
 
@@ -26,7 +29,7 @@ namespace fq
 
 class IFastqStreamReader
 {
-private:
+protected:
 	static const uint32 SwapBufferSize = 1 << 13;
 
 public:
@@ -46,7 +49,28 @@ public:
 		return eof;
 	}
 
-	bool ReadNextChunk(FastqDataChunk* chunk_);
+	virtual bool ReadNextChunk(FastqDataChunk* chunk_);
+
+	// Positional reading, where the file is split into ranges of the chunk
+	// buffer size less the swap buffer, each one cut at the first record
+	// starting after its nominal beginning -- the chunks can be then read
+	// concurrently and in any order, only files mapped in memory support it
+	//
+	virtual bool IsSequential() const
+	{
+		return true;
+	}
+
+	virtual uint64 ChunkCount(uint64 ) const
+	{
+		ASSERT(0);
+		return 0;
+	}
+
+	virtual void ReadChunkAt(uint64 , uint64 , FastqDataChunk* ) const
+	{
+		ASSERT(0);
+	}
 
 	void Close()
 	{
@@ -63,26 +87,24 @@ protected:
 		return stream->Read(memory_, size_);
 	}
 
-private:
 	core::Buffer	swapBuffer;
 	uint64			bufferSize;
 	bool			eof;
 	bool			usesCrlf;
 
-	uint64 GetNextRecordPos(uchar* data_, uint64 pos_, const uint64 size_);
+	static uint64 GetNextRecordPos(const uchar* data_, uint64 pos_, const uint64 size_, bool& usesCrlf_);
 
-	void SkipToEol(uchar* data_, uint64& pos_, const uint64 size_)
+	static void SkipToEol(const uchar* data_, uint64& pos_, const uint64 size_, bool& usesCrlf_)
 	{
 		ASSERT(pos_ < size_);
 
-		while (data_[pos_] != '\n' && data_[pos_] != '\r' && pos_ < size_)
-			++pos_;
+		pos_ = FindLineEnd(data_, pos_, size_);
 
 		if (data_[pos_] == '\r' && pos_ < size_)
 		{
 			if (data_[pos_ + 1] == '\n')
 			{
-				usesCrlf = true;
+				usesCrlf_ = true;
 				++pos_;
 			}
 		}
@@ -102,13 +124,20 @@ public:
 	void WriteNextChunk(const FastqDataChunk* chunk_)
 	{
 		ASSERT(stream != NULL);
-		stream->Write(chunk_->data.Pointer(), chunk_->size);
+		if (stream->Write(chunk_->data.Pointer(), chunk_->size) != (int64)chunk_->size)
+			throw DsrcException("Error writing FASTQ file");
 	}
 
 	void Close()
 	{
 		ASSERT(stream != NULL);
 		stream->Close();
+
+		// the writes still pending complete on closing
+		//
+		core::AsyncFileStreamWriter* asyncStream = dynamic_cast<core::AsyncFileStreamWriter*>(stream);
+		if (asyncStream != NULL && asyncStream->IsError())
+			throw DsrcException("Error writing FASTQ file");
 	}
 
 protected:
@@ -132,12 +161,70 @@ public:
 	}
 };
 
+// gzip compressed files, inflated ahead by the stream threads
+//
+class FastqGzipFileReader : public IFastqStreamReader
+{
+public:
+	FastqGzipFileReader(const std::string& fileName_, uint32 threadNum_ = 1)
+	{
+		gzipStream = new core::GzipFileStreamReader(fileName_, threadNum_);
+		stream = gzipStream;
+	}
+
+	~FastqGzipFileReader()
+	{
+		delete stream;
+	}
+
+	uint64 BuffersSize() const
+	{
+		return gzipStream->BuffersSize();
+	}
+
+private:
+	core::GzipFileStreamReader* gzipStream;
+};
+
+// the records boundaries are found directly in the file mapping, each chunk
+// is copied once from it, skipping the swap buffer
+//
+class FastqMappedFileReader : public IFastqStreamReader
+{
+public:
+	FastqMappedFileReader(const std::string& fileName_)
+	{
+		mappedStream = new core::MappedFileStreamReader(fileName_);
+		stream = mappedStream;
+	}
+
+	~FastqMappedFileReader()
+	{
+		delete stream;
+	}
+
+	bool ReadNextChunk(FastqDataChunk* chunk_);
+
+	bool IsSequential() const
+	{
+		return false;
+	}
+
+	uint64 ChunkCount(uint64 bufferSize_) const;
+	void ReadChunkAt(uint64 chunkId_, uint64 bufferSize_, FastqDataChunk* chunk_) const;
+
+private:
+	core::MappedFileStreamReader* mappedStream;
+
+	uint64 ChunkBegin(uint64 chunkId_, uint64 bufferSize_) const;
+};
+
 class FastqFileWriter : public IFastqStreamWriter
 {
 public:
 	FastqFileWriter(const std::string& fileName_)
 	{
-		stream = new core::FileStreamWriter(fileName_);
+		stream = new core::AsyncFileStreamWriter(fileName_, false, true);
 	}
 
 	~FastqFileWriter()
@@ -43,6 +43,24 @@
 #endif
 
 #include <stdio.h>
+#include <algorithm>
+
+#include <string.h>
+#include <sys/stat.h>
+
+#if defined (_WIN32)
+#	define NOMINMAX
+#	include <io.h>
+#	include <windows.h>
+#else
+#	if defined (__linux__) && !defined (_GNU_SOURCE)
+#		define _GNU_SOURCE			// fallocate()
+#	endif
+#	include <unistd.h>
+#	include <errno.h>
+#	include <fcntl.h>
+#	include <sys/mman.h>
+#endif
 
 namespace dsrc
 {
@@ -96,6 +114,13 @@ void FileStreamReader::Close()
 	impl->file = NULL;
 }
 
+bool FileStreamReader::IsSeekable() const
+{
+	ASSERT(impl->file != NULL);
+
+	return FSEEK(impl->file, 0, SEEK_CUR) == 0;
+}
+
 int64 FileStreamReader::Read(uchar *mem_, uint64 size_)
 {
 	int64 n = fread(mem_, 1, size_, impl->file);
@@ -107,10 +132,13 @@ FileStreamReaderExt::FileStreamReaderExt(const std::string& fileName_)
 	,	size(0)
 	,	position(0)
 {
-	FSEEK(impl->file, 0, SEEK_END);
-	size = FTELL(impl->file);
-
-	FSEEK(impl->file, 0, SEEK_SET);
+	// the size of non-seekable streams is unknown
+	//
+	if (FSEEK(impl->file, 0, SEEK_END) == 0)
+	{
+		size = FTELL(impl->file);
+		FSEEK(impl->file, 0, SEEK_SET);
+	}
 	position = 0;
 }
 
@@ -122,6 +150,48 @@ int64 FileStreamReaderExt::Read(uchar *mem_, uint64 size_)
 	return n;
 }
 
+int64 FileStreamReaderExt::ReadAt(uint64 pos_, uchar* mem_, uint64 size_) const
+{
+	ASSERT(impl->file != NULL);
+
+	// single calls are limited to 1 GB, reads can also return less than requested
+	//
+	const uint64 maxReadSize = 1 << 30;
+	uint64 total = 0;
+	while (total < size_)
+	{
+		const uint64 toRead = (size_ - total < maxReadSize) ? size_ - total : maxReadSize;
+		const uint64 offset = pos_ + total;
+
+#if defined (_WIN32)
+		OVERLAPPED ov;
+		memset(&ov, 0, sizeof(OVERLAPPED));
+		ov.Offset = (DWORD)offset;
+		ov.OffsetHigh = (DWORD)(offset >> 32);
+
+		DWORD n = 0;
+		if (!ReadFile((HANDLE)_get_osfhandle(_fileno(impl->file)), mem_ + total, (DWORD)toRead, &n, &ov))
+		{
+			if (GetLastError() == ERROR_HANDLE_EOF)
+				break;
+			return -1;
+		}
+#else
+		ssize_t n = pread(fileno(impl->file), mem_ + total, toRead, offset);
+		if (n < 0)
+		{
+			if (errno == EINTR)
+				continue;
+			return -1;
+		}
+#endif
+		if (n == 0)
+			break;
+		total += n;
+	}
+	return total;
+}
+
 void FileStreamReaderExt::SetPosition(uint64 pos_)
 {
 	ASSERT(impl->file != NULL);
@@ -134,9 +204,161 @@ void FileStreamReaderExt::SetPosition(uint64 pos_)
 	position = pos_;
 }
 
-FileStreamWriter::FileStreamWriter(const std::string& fileName_)
+struct MappedFileStreamReader::MappingImpl
+{
+#if defined (_WIN32)
+	HANDLE file;
+	HANDLE mapping;
+
+	MappingImpl()
+		:	file(INVALID_HANDLE_VALUE)
+		,	mapping(NULL)
+	{}
+#else
+	int file;
+
+	MappingImpl()
+		:	file(-1)
+	{}
+#endif
+};
+
+MappedFileStreamReader::MappedFileStreamReader(const std::string& fileName_)
+	:	impl(new MappingImpl())
+	,	memory(NULL)
+	,	size(0)
+	,	position(0)
+{
+#if defined (_WIN32)
+	impl->file = CreateFileA(fileName_.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING,
+							 FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+	LARGE_INTEGER fileSize;
+	if (impl->file == INVALID_HANDLE_VALUE || !GetFileSizeEx(impl->file, &fileSize))
+	{
+		Close();
+		delete impl;
+		throw DsrcException(("Cannot open file to read:" + fileName_).c_str());
+	}
+	size = fileSize.QuadPart;
+
+	impl->mapping = CreateFileMappingA(impl->file, NULL, PAGE_READONLY, 0, 0, NULL);
+	if (impl->mapping != NULL)
+		memory = (uchar*)MapViewOfFile(impl->mapping, FILE_MAP_READ, 0, 0, 0);
+#else
+	impl->file = open(fileName_.c_str(), O_RDONLY);
+	struct stat st;
+	if (impl->file < 0 || fstat(impl->file, &st) != 0)
+	{
+		Close();
+		delete impl;
+		throw DsrcException(("Cannot open file to read:" + fileName_).c_str());
+	}
+	size = st.st_size;
+
+	void* p = mmap(NULL, size, PROT_READ, MAP_SHARED, impl->file, 0);
+	if (p != MAP_FAILED)
+	{
+		memory = (uchar*)p;
+		madvise(memory, size, MADV_SEQUENTIAL);
+	}
+#endif
+
+	if (memory == NULL)
+	{
+		Close();
+		delete impl;
+		throw DsrcException(("Cannot map file:" + fileName_).c_str());
+	}
+}
+
+MappedFileStreamReader::~MappedFileStreamReader()
+{
+	Close();
+	delete impl;
+}
+
+bool MappedFileStreamReader::IsMappable(const std::string& fileName_)
+{
+#if defined (_WIN32)
+	struct _stat64 st;
+	return _stat64(fileName_.c_str(), &st) == 0 && (st.st_mode & _S_IFREG) != 0 && st.st_size > 0;
+#else
+	struct stat st;
+	return stat(fileName_.c_str(), &st) == 0 && S_ISREG(st.st_mode) && st.st_size > 0;
+#endif
+}
+
+void MappedFileStreamReader::Close()
 {
-	FILE* f = FOPEN(fileName_.c_str(), "wb");
+#if defined (_WIN32)
+	if (memory != NULL)
+		UnmapViewOfFile(memory);
+	if (impl->mapping != NULL)
+		CloseHandle(impl->mapping);
+	if (impl->file != INVALID_HANDLE_VALUE)
+		CloseHandle(impl->file);
+
+	impl->mapping = NULL;
+	impl->file = INVALID_HANDLE_VALUE;
+#else
+	if (memory != NULL)
+		munmap(memory, size);
+	if (impl->file >= 0)
+		close(impl->file);
+
+	impl->file = -1;
+#endif
+	memory = NULL;
+}
+
+int64 MappedFileStreamReader::Read(uchar* mem_, uint64 size_)
+{
+	ASSERT(memory != NULL);
+
+	const uint64 n = (size_ < size - position) ? size_ : size - position;
+	std::copy(memory + position, memory + position + n, mem_);
+	position += n;
+	return n;
+}
+
+void MappedFileStreamReader::SetPosition(uint64 pos_)
+{
+	if (pos_ > size)
+	{
+		throw DsrcException("Position exceeds stream size");
+	}
+	position = pos_;
+}
+
+void MappedFileStreamReader::AdviseWillNeed(uint64 pos_, uint64 size_)
+{
+#if !defined (_WIN32)
+	// the range needs to start at the page boundary
+	//
+	const uint64 pageSize = sysconf(_SC_PAGESIZE);
+	const uint64 begin = pos_ - pos_ % pageSize;
+	const uint64 end = (pos_ + size_ < size) ? pos_ + size_ : size;
+	if (begin < end)
+		madvise(memory + begin, end - begin, MADV_WILLNEED);
+#endif
+}
+
+void MappedFileStreamReader::AdviseDontNeed(uint64 pos_, uint64 size_)
+{
+#if !defined (_WIN32)
+	// only the pages fully inside the range can be dropped
+	//
+	const uint64 pageSize = sysconf(_SC_PAGESIZE);
+	const uint64 begin = (pos_ + pageSize - 1) / pageSize * pageSize;
+	const uint64 end = (pos_ + size_) / pageSize * pageSize;
+	if (begin < end)
+		madvise(memory + begin, end - begin, MADV_DONTNEED);
+#endif
+}
+
+FileStreamWriter::FileStreamWriter(const std::string& fileName_, bool update_)
+{
+	FILE* f = FOPEN(fileName_.c_str(), update_ ? "r+b" : "wb");
 	if (f == NULL)
 	{
 		throw DsrcException(("Cannot open file to write:" + fileName_).c_str());
@@ -160,14 +382,21 @@ void FileStreamWriter::Close()
 	impl->file = NULL;
 }
 
+bool FileStreamWriter::IsSeekable() const
+{
+	ASSERT(impl->file != NULL);
+
+	return FSEEK(impl->file, 0, SEEK_CUR) == 0;
+}
+
 int64 FileStreamWriter::Write(const uchar *mem_, uint64 size_)
 {
 	int64 n = fwrite(mem_, 1, size_, impl->file);
 	return n;
 }
 
-FileStreamWriterExt::FileStreamWriterExt(const std::string& fileName_)
-	:	FileStreamWriter(fileName_)
+FileStreamWriterExt::FileStreamWriterExt(const std::string& fileName_, bool update_)
+	:	FileStreamWriter(fileName_, update_)
 	,	position(0)
 {}
 
@@ -187,6 +416,78 @@ void FileStreamWriterExt::SetPosition(uint64 pos_)
 	position = pos_;
 }
 
+int64 FileStreamWriterExt::WriteAt(uint64 pos_, const uchar* mem_, uint64 size_)
+{
+	ASSERT(impl->file != NULL);
+
+	const uint64 maxWriteSize = 1 << 30;
+	uint64 total = 0;
+	while (total < size_)
+	{
+		const uint64 toWrite = (size_ - total < maxWriteSize) ? size_ - total : maxWriteSize;
+		const uint64 offset = pos_ + total;
+
+#if defined (_WIN32)
+		OVERLAPPED ov;
+		memset(&ov, 0, sizeof(OVERLAPPED));
+		ov.Offset = (DWORD)offset;
+		ov.OffsetHigh = (DWORD)(offset >> 32);
+
+		DWORD n = 0;
+		if (!WriteFile((HANDLE)_get_osfhandle(_fileno(impl->file)), mem_ + total, (DWORD)toWrite, &n, &ov))
+			return -1;
+#else
+		ssize_t n = pwrite(fileno(impl->file), mem_ + total, toWrite, offset);
+		if (n < 0)
+		{
+			if (errno == EINTR)
+				continue;
+			return -1;
+		}
+#endif
+		if (n == 0)
+			break;
+		total += n;
+	}
+	return total;
+}
+
+void FileStreamWriterExt::Preallocate(uint64 pos_, uint64 size_)
+{
+	ASSERT(impl->file != NULL);
+
+#if defined (__linux__)
+	fallocate(fileno(impl->file), FALLOC_FL_KEEP_SIZE, pos_, size_);
+#endif
+}
+
+void FileStreamWriterExt::ReleasePreallocated()
+{
+	ASSERT(impl->file != NULL);
+
+#if defined (__linux__)
+	// truncating to the current size drops the blocks past the end
+	//
+	struct stat st;
+	if (fstat(fileno(impl->file), &st) == 0)
+		(void)ftruncate(fileno(impl->file), st.st_size);
+#endif
+}
+
+void FileStreamWriterExt::Truncate(uint64 size_)
+{
+	ASSERT(impl->file != NULL);
+
+	fflush(impl->file);
+
+#if defined (_WIN32)
+	if (_chsize_s(_fileno(impl->file), size_) != 0)
+#else
+	if (ftruncate(fileno(impl->file), size_) != 0)
+#endif
+		throw DsrcException("Cannot truncate file");
+}
+
 } // namespace core
 
 } // namespace dsrc
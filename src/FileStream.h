@@ -38,6 +38,9 @@ public:
 
 	void Close();
 
+	// pipes and FIFOs can be read only sequentially
+	bool IsSeekable() const;
+
 	virtual int64 Read(uchar* mem_, uint64 size_);
 };
 
@@ -60,20 +63,78 @@ public:
 
 	virtual int64 Read(uchar* mem_, uint64 size_);
 
+	// positional read leaving the stream position intact, can be called concurrently
+	int64 ReadAt(uint64 pos_, uchar* mem_, uint64 size_) const;
+
 private:
 	uint64 size;
 	uint64 position;
 };
 
 
+// read-only mapping of the whole file, the data can be accessed in place
+//
+class MappedFileStreamReader : public IDataStreamReader
+{
+public:
+	MappedFileStreamReader(const std::string& fileName_);
+	~MappedFileStreamReader();
+
+	// only non-empty regular files can be mapped
+	static bool IsMappable(const std::string& fileName_);
+
+	void Close();
+
+	virtual int64 Read(uchar* mem_, uint64 size_);
+
+	const uchar* Pointer() const
+	{
+		return memory;
+	}
+
+	uint64 Size() const
+	{
+		return size;
+	}
+
+	uint64 Position() const
+	{
+		return position;
+	}
+
+	void SetPosition(uint64 pos_);
+
+	// access hints for the given range: prefetch it ahead or drop its pages once
+	// consumed, ignored where not supported
+	void AdviseWillNeed(uint64 pos_, uint64 size_);
+	void AdviseDontNeed(uint64 pos_, uint64 size_);
+
+private:
+	struct MappingImpl;
+	MappingImpl* impl;
+
+	uchar* memory;
+	uint64 size;
+	uint64 position;
+
+	MappedFileStreamReader(const MappedFileStreamReader&) {}
+	MappedFileStreamReader& operator= (const MappedFileStreamReader&)
+	{ return *this; }
+};
+
+
 class FileStreamWriter : public IDataStreamWriter, public IFileStream
 {
 public:
-	FileStreamWriter(const std::string& fileName_);
+	// the update mode opens an existing file without truncating it
+	FileStreamWriter(const std::string& fileName_, bool update_ = false);
 	~FileStreamWriter();
 
 	void Close();
 
+	// pipes and FIFOs can be written only sequentially
+	bool IsSeekable() const;
+
 	int64 PerformIo(uchar* mem_, uint64 size_)
 	{
 		return Write(mem_, size_);
@@ -85,9 +146,9 @@ public:
 class FileStreamWriterExt : public FileStreamWriter
 {
 public:
-	FileStreamWriterExt(const std::string& fileName_);
+	FileStreamWriterExt(const std::string& fileName_, bool update_ = false);
 
-	void SetPosition(uint64 pos_);
+	virtual void SetPosition(uint64 pos_);
 
 	uint64 Position() const
 	{
@@ -96,7 +157,18 @@ public:
 
 	virtual	int64 Write(const uchar* mem_, uint64 size_);
 
-private:
+	// positional write leaving the stream position intact
+	int64 WriteAt(uint64 pos_, const uchar* mem_, uint64 size_);
+
+	// reserves the disk space for the range without changing the file size and
+	// frees the space reserved past the end of file, ignored where not supported
+	void Preallocate(uint64 pos_, uint64 size_);
+	void ReleasePreallocated();
+
+	// cuts or extends the file to the given size, the pending writes need to be flushed first
+	void Truncate(uint64 size_);
+
+protected:
 	uint64 position;
 };
 
@@ -0,0 +1,471 @@
+/*
+  This file is a part of DSRC software distributed under GNU GPL 2 licence.
+  The homepage of the DSRC project is http://sun.aei.polsl.pl/dsrc
+
+  Authors: Lucas Roguski and Sebastian Deorowicz
+
+  Version: 2.00
+*/
+
+#include "GzipFileStream.h"
+#include "Common.h"
+
+#include <algorithm>
+
+#ifdef USE_ZLIB
+#include <zlib.h>
+#endif
+
+namespace dsrc
+{
+
+namespace core
+{
+
+static uint32 LoadLe16(const uchar* data_)
+{
+	return data_[0] | (data_[1] << 8);
+}
+
+static uint32 LoadLe32(const uchar* data_)
+{
+	return data_[0] | (data_[1] << 8) | (data_[2] << 16) | ((uint32)data_[3] << 24);
+}
+
+
+#ifdef USE_ZLIB
+
+// inflates the BGZF members of a batch one after another, every member
+// declares its compressed size, its inflated size and its CRC32
+//
+static uint64 InflateMembers(z_stream& zs_, const uchar* input_, uint64 inputSize_, uchar* output_, uint64 outputSize_)
+{
+	const uint32 headerSize = GzipFileStreamReader::BgzfHeaderSize;
+	const uint32 trailerSize = 8;
+
+	uint64 inPos = 0;
+	uint64 outPos = 0;
+	while (inPos < inputSize_)
+	{
+		const uchar* member = input_ + inPos;
+		const uint32 memberSize = LoadLe16(member + 16) + 1;
+		const uint32 crc = LoadLe32(member + memberSize - trailerSize);
+		const uint32 rawSize = LoadLe32(member + memberSize - 4);
+
+		if (rawSize > outputSize_ - outPos)
+			throw DsrcException("Invalid BGZF block size");
+
+		inflateReset(&zs_);
+		zs_.next_in = (Bytef*)(member + headerSize);
+		zs_.avail_in = memberSize - headerSize - trailerSize;
+		zs_.next_out = output_ + outPos;
+		zs_.avail_out = rawSize;
+
+		if (inflate(&zs_, Z_FINISH) != Z_STREAM_END || zs_.avail_out != 0)
+			throw DsrcException("Corrupted BGZF block");
+
+		if (crc32(0, output_ + outPos, rawSize) != crc)
+			throw DsrcException("gzip CRC32 checksums mismatch");
+
+		inPos += memberSize;
+		outPos += rawSize;
+	}
+
+	return outPos;
+}
+
+GzipFileStreamReader::GzipFileStreamReader(const std::string& fileName_, uint32 threadNum_)
+	:	file(NULL)
+	,	headerSize(0)
+	,	headerPos(0)
+	,	blocked(false)
+	,	buffersSize(0)
+	,	nextBatchId(0)
+	,	readBatchId(0)
+	,	readPos(0)
+	,	inputEnd(false)
+	,	closing(false)
+{
+	file = new FileStreamReader(fileName_);
+
+	headerSize = ReadInput(header, BgzfHeaderSize);
+	blocked = IsBgzfHeader(header, headerSize);
+
+	// the BGZF batches are inflated concurrently and each one needs
+	// its compressed members buffered, the single stream is inflated
+	// from one input buffer of its thread
+	//
+	const uint32 threadNum = blocked ? MAX(threadNum_, 1) : 1;
+	const uint32 batchNum = blocked ? 2 * threadNum + 1 : 3;
+
+	batches.resize(batchNum);
+	for (uint32 i = 0; i < batchNum; ++i)
+	{
+		batches[i].input = blocked ? new Buffer(BatchSize) : NULL;
+		batches[i].output = new Buffer(BatchSize);
+		batches[i].inputSize = 0;
+		batches[i].outputSize = 0;
+		batches[i].ready = false;
+	}
+	buffersSize = (blocked ? 2 * batchNum : batchNum + 1) * BatchSize;
+
+	void (GzipFileStreamReader::*inflateLoop)() = blocked ? &GzipFileStreamReader::InflateBlocks
+														  : &GzipFileStreamReader::InflateStream;
+	for (uint32 i = 0; i < threadNum; ++i)
+		threads.push_back(new th::thread(inflateLoop, this));
+}
+
+void GzipFileStreamReader::InflateBlocks()
+{
+	z_stream zs;
+	zs.zalloc = Z_NULL;
+	zs.zfree = Z_NULL;
+	zs.opaque = Z_NULL;
+	zs.next_in = Z_NULL;
+	zs.avail_in = 0;
+
+	if (inflateInit2(&zs, -MAX_WBITS) != Z_OK)
+	{
+		SetError("Cannot initialize zlib");
+		return;
+	}
+
+	try
+	{
+		for ( ;; )
+		{
+			Batch* batch = NULL;
+
+			// the members are read in order and inflated outside of the lock
+			//
+			{
+				th::lock_guard<th::mutex> lock(claimMutex);
+
+				uint64 batchId = 0;
+				if (!ClaimBatch(batchId))
+					break;
+
+				batch = &batches[batchId % batches.size()];
+				ReadMembers(*batch);
+
+				if (batch->inputSize == 0)
+				{
+					EndInput();
+					break;
+				}
+				AddBatch(false);
+			}
+
+			batch->outputSize = InflateMembers(zs, batch->input->Pointer(), batch->inputSize,
+											   batch->output->Pointer(), batch->output->Size());
+			SetReady(*batch);
+		}
+	}
+	catch (const std::exception& e_)
+	{
+		SetError(e_.what());
+	}
+
+	inflateEnd(&zs);
+}
+
+void GzipFileStreamReader::InflateStream()
+{
+	z_stream zs;
+	zs.zalloc = Z_NULL;
+	zs.zfree = Z_NULL;
+	zs.opaque = Z_NULL;
+	zs.next_in = Z_NULL;
+	zs.avail_in = 0;
+
+	if (inflateInit2(&zs, MAX_WBITS + 16) != Z_OK)			// gzip header
+	{
+		SetError("Cannot initialize zlib");
+		return;
+	}
+
+	try
+	{
+		Buffer input(BatchSize);
+		bool memberEnd = false;			// the file can end only after a whole member
+		bool eof = false;
+
+		uint64 batchId = 0;
+		while (!eof && ClaimBatch(batchId))
+		{
+			Batch& batch = batches[batchId % batches.size()];
+
+			zs.next_out = batch.output->Pointer();
+			zs.avail_out = (uInt)batch.output->Size();
+
+			while (zs.avail_out > 0)
+			{
+				if (zs.avail_in == 0)
+				{
+					const uint64 n = ReadInput(input.Pointer(), input.Size());
+					if (n == 0)
+					{
+						if (!memberEnd)
+							throw DsrcException("Unexpected end of gzip file");
+						eof = true;
+						break;
+					}
+
+					zs.next_in = input.Pointer();
+					zs.avail_in = (uInt)n;
+				}
+
+				const int ret = inflate(&zs, Z_NO_FLUSH);
+				if (ret == Z_STREAM_END)
+				{
+					// the next member follows, as written by pigz or appending
+					//
+					inflateReset(&zs);
+					memberEnd = true;
+				}
+				else if (ret == Z_OK)
+				{
+					memberEnd = false;
+				}
+				else
+				{
+					throw DsrcException(zs.msg != NULL ? zs.msg : "Corrupted gzip file");
+				}
+			}
+
+			batch.outputSize = batch.output->Size() - zs.avail_out;
+			if (batch.outputSize > 0)
+				AddBatch(true);
+		}
+
+		EndInput();
+	}
+	catch (const std::exception& e_)
+	{
+		SetError(e_.what());
+	}
+
+	inflateEnd(&zs);
+}
+
+#else
+
+GzipFileStreamReader::GzipFileStreamReader(const std::string& , uint32 )
+	:	file(NULL)
+	,	headerSize(0)
+	,	headerPos(0)
+	,	blocked(false)
+	,	buffersSize(0)
+	,	nextBatchId(0)
+	,	readBatchId(0)
+	,	readPos(0)
+	,	inputEnd(false)
+	,	closing(false)
+{
+	throw DsrcException("gzip compressed input is not supported, DSRC was built without zlib");
+}
+
+void GzipFileStreamReader::InflateBlocks()
+{
+	ASSERT(0);
+}
+
+void GzipFileStreamReader::InflateStream()
+{
+	ASSERT(0);
+}
+
+#endif
+
+GzipFileStreamReader::~GzipFileStreamReader()
+{
+	Stop();
+
+	for (std::vector<Batch>::iterator i = batches.begin(); i != batches.end(); ++i)
+	{
+		delete i->input;
+		delete i->output;
+	}
+
+	delete file;
+}
+
+bool GzipFileStreamReader::IsGzipFile(const std::string& fileName_)
+{
+	if (!MappedFileStreamReader::IsMappable(fileName_))
+		return false;
+
+	FileStreamReader file(fileName_);
+	uchar magic[2];
+	return file.Read(magic, 2) == 2 && magic[0] == 0x1f && magic[1] == 0x8b;
+}
+
+bool GzipFileStreamReader::IsBgzfHeader(const uchar* data_, uint64 size_)
+{
+	return size_ == BgzfHeaderSize
+		&& data_[0] == 0x1f && data_[1] == 0x8b && data_[2] == 8 && (data_[3] & 4) != 0		// FEXTRA
+		&& LoadLe16(data_ + 10) == 6
+		&& data_[12] == 'B' && data_[13] == 'C' && LoadLe16(data_ + 14) == 2;
+}
+
+uint64 GzipFileStreamReader::ReadInput(uchar* mem_, uint64 size_)
+{
+	// the bytes read ahead while detecting BGZF go first
+	//
+	uint64 done = MIN(size_, (uint64)(headerSize - headerPos));
+	std::copy(header + headerPos, header + headerPos + done, mem_);
+	headerPos += done;
+
+	while (done < size_)
+	{
+		const int64 n = file->Read(mem_ + done, size_ - done);
+		if (n <= 0)
+			break;
+		done += n;
+	}
+	return done;
+}
+
+void GzipFileStreamReader::ReadMembers(Batch& batch_)
+{
+	batch_.inputSize = 0;
+
+	for (uint32 i = 0; i < BatchMemberNum; ++i)
+	{
+		uchar* member = batch_.input->Pointer() + batch_.inputSize;
+
+		const uint64 n = ReadInput(member, BgzfHeaderSize);
+		if (n == 0)
+			break;
+
+		if (!IsBgzfHeader(member, n))
+			throw DsrcException("Invalid BGZF block header");
+
+		const uint32 memberSize = LoadLe16(member + 16) + 1;
+		if (memberSize < BgzfHeaderSize + 8)
+			throw DsrcException("Invalid BGZF block size");
+
+		if (ReadInput(member + BgzfHeaderSize, memberSize - BgzfHeaderSize) != memberSize - BgzfHeaderSize)
+			throw DsrcException("Unexpected end of gzip file");
+
+		batch_.inputSize += memberSize;
+	}
+}
+
+bool GzipFileStreamReader::ClaimBatch(uint64& batchId_)
+{
+	th::unique_lock<th::mutex> lock(mutex);
+
+	while (!closing && error.empty() && nextBatchId >= readBatchId + batches.size())
+		freeCondition.wait(lock);
+
+	if (closing || !error.empty() || inputEnd)
+		return false;
+
+	batchId_ = nextBatchId;
+	return true;
+}
+
+void GzipFileStreamReader::AddBatch(bool ready_)
+{
+	th::lock_guard<th::mutex> lock(mutex);
+
+	batches[nextBatchId % batches.size()].ready = ready_;
+	nextBatchId++;
+	readyCondition.notify_all();
+}
+
+void GzipFileStreamReader::SetReady(Batch& batch_)
+{
+	th::lock_guard<th::mutex> lock(mutex);
+
+	batch_.ready = true;
+	readyCondition.notify_all();
+}
+
+void GzipFileStreamReader::EndInput()
+{
+	th::lock_guard<th::mutex> lock(mutex);
+
+	inputEnd = true;
+	readyCondition.notify_all();
+}
+
+void GzipFileStreamReader::SetError(const std::string& error_)
+{
+	th::lock_guard<th::mutex> lock(mutex);
+
+	if (error.empty())
+		error = error_;
+	readyCondition.notify_all();
+	freeCondition.notify_all();
+}
+
+int64 GzipFileStreamReader::Read(uchar* mem_, uint64 size_)
+{
+	uint64 done = 0;
+	while (done < size_)
+	{
+		Batch* batch = NULL;
+		{
+			th::unique_lock<th::mutex> lock(mutex);
+
+			while (error.empty() && !(inputEnd && readBatchId == nextBatchId)
+				   && !(readBatchId < nextBatchId && batches[readBatchId % batches.size()].ready))
+				readyCondition.wait(lock);
+
+			if (!error.empty())
+				throw DsrcException(error);
+
+			if (readBatchId == nextBatchId)
+				break;
+
+			batch = &batches[readBatchId % batches.size()];
+		}
+
+		const uint64 toCopy = MIN(size_ - done, batch->outputSize - readPos);
+		std::copy(batch->output->Pointer() + readPos, batch->output->Pointer() + readPos + toCopy, mem_ + done);
+		readPos += toCopy;
+		done += toCopy;
+
+		if (readPos == batch->outputSize)
+		{
+			th::lock_guard<th::mutex> lock(mutex);
+
+			batch->ready = false;
+			readBatchId++;
+			readPos = 0;
+			freeCondition.notify_all();
+		}
+	}
+
+	return done;
+}
+
+void GzipFileStreamReader::Close()
+{
+	Stop();
+
+	ASSERT(file != NULL);
+	file->Close();
+}
+
+void GzipFileStreamReader::Stop()
+{
+	{
+		th::lock_guard<th::mutex> lock(mutex);
+		closing = true;
+		freeCondition.notify_all();
+	}
+
+	for (std::vector<th::thread*>::iterator i = threads.begin(); i != threads.end(); ++i)
+	{
+		(*i)->join();
+		delete *i;
+	}
+	threads.clear();
+}
+
+} // namespace core
+
+} // namespace dsrc
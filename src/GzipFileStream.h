@@ -0,0 +1,127 @@
+/*
+  This file is a part of DSRC software distributed under GNU GPL 2 licence.
+  The homepage of the DSRC project is http://sun.aei.polsl.pl/dsrc
+
+  Authors: Lucas Roguski and Sebastian Deorowicz
+
+  Version: 2.00
+*/
+
+#ifndef H_GZIPFILESTREAM
+#define H_GZIPFILESTREAM
+
+#include "../include/dsrc/Globals.h"
+
+#include <string>
+#include <vector>
+
+#include "FileStream.h"
+#include "Buffer.h"
+
+#ifdef USE_BOOST_THREAD
+#include <boost/thread.hpp>
+namespace th = boost;
+#else
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+namespace th = std;
+#endif
+
+namespace dsrc
+{
+
+namespace core
+{
+
+// gzip compressed file inflated ahead of the reader by separate threads: the
+// members of BGZF files (as written by bgzip or samtools) are independent and
+// are inflated concurrently in batches, any other gzip file is inflated by a
+// single thread running alongside the reader -- the batches are read in the
+// file order in both cases, zlib is required (built with USE_ZLIB)
+//
+class GzipFileStreamReader : public IDataStreamReader
+{
+public:
+	static const uint32 BgzfHeaderSize = 18;
+	static const uint32 BgzfMaxMemberSize = 1 << 16;
+	static const uint32 BatchMemberNum = 64;
+	static const uint64 BatchSize = (uint64)BgzfMaxMemberSize * BatchMemberNum;
+
+	GzipFileStreamReader(const std::string& fileName_, uint32 threadNum_ = 1);
+	~GzipFileStreamReader();
+
+	// only regular files are checked for the gzip magic bytes
+	static bool IsGzipFile(const std::string& fileName_);
+
+	int64 Read(uchar* mem_, uint64 size_);
+
+	void Close();
+
+	bool IsBlocked() const
+	{
+		return blocked;
+	}
+
+	// memory of the compressed and inflated batches in flight
+	uint64 BuffersSize() const
+	{
+		return buffersSize;
+	}
+
+private:
+	struct Batch
+	{
+		Buffer* input;				// BGZF members, the single stream is read by its thread
+		Buffer* output;
+		uint64 inputSize;
+		uint64 outputSize;
+		bool ready;
+	};
+
+	FileStreamReader* file;
+	uchar header[BgzfHeaderSize];	// the first bytes read ahead to detect BGZF
+	uint32 headerSize;
+	uint32 headerPos;
+	bool blocked;
+	uint64 buffersSize;
+
+	std::vector<Batch> batches;
+	uint64 nextBatchId;				// the next batch to be filled
+	uint64 readBatchId;				// the batch being read
+	uint64 readPos;
+	bool inputEnd;					// all the batches filled
+	bool closing;
+	std::string error;
+
+	th::mutex claimMutex;			// BGZF: the members are read from the file in order
+	th::mutex mutex;
+	th::condition_variable readyCondition;
+	th::condition_variable freeCondition;
+	std::vector<th::thread*> threads;
+
+	GzipFileStreamReader(const GzipFileStreamReader&) {}
+	GzipFileStreamReader& operator= (const GzipFileStreamReader&)
+	{ return *this; }
+
+	static bool IsBgzfHeader(const uchar* data_, uint64 size_);
+
+	uint64 ReadInput(uchar* mem_, uint64 size_);
+
+	bool ClaimBatch(uint64& batchId_);
+	void AddBatch(bool ready_);
+	void SetReady(Batch& batch_);
+	void EndInput();
+	void SetError(const std::string& error_);
+
+	void ReadMembers(Batch& batch_);
+	void InflateBlocks();
+	void InflateStream();
+	void Stop();
+};
+
+} // namespace core
+
+} // namespace dsrc
+
+#endif // H_GZIPFILESTREAM
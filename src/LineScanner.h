@@ -0,0 +1,79 @@
+/*
+  This file is a part of DSRC software distributed under GNU GPL 2 licence.
+  The homepage of the DSRC project is http://sun.aei.polsl.pl/dsrc
+
+  Authors: Lucas Roguski and Sebastian Deorowicz
+
+  Version: 2.00
+*/
+
+#ifndef H_LINESCANNER
+#define H_LINESCANNER
+
+#include "../include/dsrc/Globals.h"
+
+#if defined(__i386__) || defined(__x86_64__) || defined(_M_IX86) || defined(_M_X64)
+#include <emmintrin.h>
+#define SSE2_LINE_SCAN 1
+#else
+#define SSE2_LINE_SCAN 0
+#endif
+
+#if SSE2_LINE_SCAN && defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+namespace dsrc
+{
+
+namespace fq
+{
+
+#if SSE2_LINE_SCAN
+
+// index of the lowest set bit, the mask cannot be empty
+//
+inline uint32 LowestBitIndex(uint32 mask_)
+{
+	ASSERT(mask_ != 0);
+#if defined(_MSC_VER)
+	unsigned long idx;
+	_BitScanForward(&idx, mask_);
+	return idx;
+#else
+	return __builtin_ctz(mask_);
+#endif
+}
+
+#endif
+
+// Finds the end of the line starting at the given position: the first
+// '\n' or '\r' in [pos_, size_), or size_ if there is none -- the bytes are
+// compared 16 at a time, the loads never reach past size_
+//
+inline uint64 FindLineEnd(const uchar* data_, uint64 pos_, const uint64 size_)
+{
+#if SSE2_LINE_SCAN
+	const __m128i lf = _mm_set1_epi8('\n');
+	const __m128i cr = _mm_set1_epi8('\r');
+
+	for ( ; pos_ + 16 <= size_; pos_ += 16)
+	{
+		const __m128i x = _mm_loadu_si128((const __m128i*)(data_ + pos_));
+		const uint32 mask = _mm_movemask_epi8(_mm_or_si128(_mm_cmpeq_epi8(x, lf), _mm_cmpeq_epi8(x, cr)));
+
+		if (mask != 0)
+			return pos_ + LowestBitIndex(mask);
+	}
+#endif
+
+	while (pos_ < size_ && data_[pos_] != '\n' && data_[pos_] != '\r')
+		++pos_;
+	return pos_;
+}
+
+} // namespace fq
+
+} // namespace dsrc
+
+#endif // H_LINESCANNER
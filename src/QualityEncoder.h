@@ -13,6 +13,7 @@
 #include "../include/dsrc/Globals.h"
 
 #include "RangeCoder.h"
+#include "RansCoder.h"
 #include "SymbolCoderRC.h"
 
 namespace dsrc
@@ -30,24 +31,22 @@ public:
 	static const uint32 TotalOrder = _TTotalOrder;
 
 	TQualityModelBase()
-		:	models(NULL)
-		,	hash(0)
+		:	hash(0)
 		,	symBuffer(0)
-	{
-		models = new Coder[ModelCount];
-	}
-
-	~TQualityModelBase()
-	{
-		delete models;
-	}
+	{}
 
 	void Clear()
 	{
 		hash = 0;
 		symBuffer = 0;
-		CoderStatType* cd = (CoderStatType*)models;
-		std::fill(cd, cd + ModelCount * SymbolCount, 1);
+		models.Clear();
+	}
+
+	// size of the context models table allocated by the model
+	//
+	static uint64 TableSize()
+	{
+		return CoderTable::EntriesSize();
 	}
 
 protected:
@@ -68,9 +67,9 @@ protected:
 	static const THash SymbolContextBits = AlphabetBits * SymbolOrder;
 
 	typedef TSymbolCoderRC<AlphabetSize> Coder;
-	typedef typename Coder::StatType CoderStatType;
+	typedef TContextTable<Coder, ModelCount> CoderTable;
 
-	Coder* models;
+	CoderTable models;
 	THash hash;
 	THash symBuffer;
 
@@ -99,14 +98,16 @@ template <uint32 _TSymbolCount, uint32 _TOrder>
 class TQualityModel : public TQualityModelBase<_TSymbolCount, _TOrder, _TOrder>
 {
 public:
-	void EncodeSymbol(RangeEncoder& rc_, uint32 sym_)
+	template <class _TEncoder>
+	void EncodeSymbol(_TEncoder& rc_, uint32 sym_)
 	{
 		Super::models[Super::GetHash()].EncodeSymbol(rc_, sym_);
 
 		Super::UpdateHash(sym_);
 	}
 
-	uint32 DecodeSymbol(RangeDecoder& rc_)
+	template <class _TDecoder>
+	uint32 DecodeSymbol(_TDecoder& rc_)
 	{
 		uint32 sym = Super::models[Super::GetHash()].DecodeSymbol(rc_);
 
@@ -123,7 +124,8 @@ template <uint32 _TSymbolCount, uint32 _TOrder>
 class TQualityModelExt : public TQualityModelBase<_TSymbolCount, _TOrder, _TOrder + 1>
 {
 public:
-	void EncodeSymbol(RangeEncoder& rc_, uint32 sym_, uint32 ctx0_)
+	template <class _TEncoder>
+	void EncodeSymbol(_TEncoder& rc_, uint32 sym_, uint32 ctx0_)
 	{
 		ASSERT(ctx0_ < Super::AlphabetSize);
 		ASSERT(sym_ < Super::AlphabetSize);
@@ -135,7 +137,8 @@ public:
 		Super::UpdateHash(sym_);
 	}
 
-	uint32 DecodeSymbol(RangeDecoder& rc_, uint32 ctx0_)
+	template <class _TDecoder>
+	uint32 DecodeSymbol(_TDecoder& rc_, uint32 ctx0_)
 	{
 		ASSERT(ctx0_ < Super::AlphabetSize);
 
@@ -180,7 +183,8 @@ public:
 		ASSERT(stats_.symbolCount < SymbolCount);
 	}
 
-	void Encode(const fq::FastqRecord& rec_, Model& model_, RangeEncoder& coder_)
+	template <class _TEncoder>
+	void Encode(const fq::FastqRecord& rec_, Model& model_, _TEncoder& coder_)
 	{
 		for (uint32 j = 0; j < rec_.qualityLen; ++j)
 		{
@@ -192,7 +196,8 @@ public:
 		}
 	}
 
-	void Decode(fq::FastqRecord& rec_, Model& model_, RangeDecoder& coder_)
+	template <class _TDecoder>
+	void Decode(fq::FastqRecord& rec_, Model& model_, _TDecoder& coder_)
 	{
 		uint32 nCount = 0;
 
@@ -233,7 +238,8 @@ public:
 		ASSERT(stats_.symbolCount < SymbolCount);
 	}
 
-	void Encode(const fq::FastqRecord& rec_, Model& model_, RangeEncoder& coder_)
+	template <class _TEncoder>
+	void Encode(const fq::FastqRecord& rec_, Model& model_, _TEncoder& coder_)
 	{
 		for (uint32 j = 0; j < rec_.qualityLen; ++j)
 		{
@@ -247,7 +253,8 @@ public:
 		}
 	}
 
-	void Decode(fq::FastqRecord& rec_, Model& model_, RangeDecoder& coder_)
+	template <class _TDecoder>
+	void Decode(fq::FastqRecord& rec_, Model& model_, _TDecoder& coder_)
 	{
 		uint32 nCount = 0;
 
@@ -296,7 +303,8 @@ public:
 		std::copy(stats_.symbols, stats_.symbols + MaxSymbolCount, symbols);
 	}
 
-	void Encode(const fq::FastqRecord& rec_, Model& model_, RangeEncoder& coder_)
+	template <class _TEncoder>
+	void Encode(const fq::FastqRecord& rec_, Model& model_, _TEncoder& coder_)
 	{
 		for (uint32 j = 0; j < rec_.qualityLen; ++j)
 		{
@@ -310,7 +318,8 @@ public:
 		}
 	}
 
-	void Decode(fq::FastqRecord& rec_, Model& model_, RangeDecoder& coder_)
+	template <class _TDecoder>
+	void Decode(fq::FastqRecord& rec_, Model& model_, _TDecoder& coder_)
 	{
 		uint32 nCount = 0;
 
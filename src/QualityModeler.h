@@ -21,6 +21,11 @@ public:
 	virtual ~IQualityModeler() {}
 
 	virtual void ProcessStats(const QualityStats& stats_) = 0;
+
+	// selects the coder of the adaptive order models, the other ones ignore it
+	//
+	virtual void SetEntropyCoder(EntropyCoder::CoderEnum ) {}
+
 	virtual void Encode(core::BitMemoryWriter& writer_, const fq::FastqRecord* records_, uint32 recordsCount_) = 0;
 	virtual void Decode(core::BitMemoryReader& reader_, fq::FastqRecord* records_, uint32 recordsCount_) = 0;
 
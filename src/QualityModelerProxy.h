@@ -12,6 +12,8 @@
 
 #include "../include/dsrc/Globals.h"
 
+#include <algorithm>
+
 #include "Fastq.h"
 #include "QualityModeler.h"
 #include "QualityPositionModeler.h"
@@ -30,8 +32,14 @@ public:
 	IQualityModelerProxy()
 		:	modeler(NULL)
 		,	currentSchemeId(SchemeNone)
+		,	entropyCoder(EntropyCoder::Range)
 	{}
 
+	void SetEntropyCoder(EntropyCoder::CoderEnum coder_)
+	{
+		entropyCoder = coder_;
+	}
+
 	void ProcessStats(const QualityStats& stats_)
 	{
 		ASSERT(stats_.symbolCount < MaxSymbolCount);
@@ -54,6 +62,7 @@ public:
 
 		modeler = SelectModeler(currentSchemeId);
 		ASSERT(modeler != NULL);
+		modeler->SetEntropyCoder(entropyCoder);
 		modeler->Encode(writer_, records_, recordsCount_);
 	}
 
@@ -66,6 +75,7 @@ public:
 
 		modeler = SelectModeler(currentSchemeId);
 		ASSERT(modeler != NULL);
+		modeler->SetEntropyCoder(entropyCoder);
 		modeler->Decode(reader_, records_, recordsCount_);
 	}
 
@@ -77,6 +87,7 @@ protected:
 
 	IQualityModeler* modeler;
 	SchemeId currentSchemeId;
+	EntropyCoder::CoderEnum entropyCoder;
 
 	virtual SchemeId SelectSchemeId(const QualityStats& stats_) = 0;
 	virtual IQualityModeler* SelectModeler(SchemeId schemeId_) = 0;
@@ -148,6 +159,11 @@ public:
 		modeler->ProcessStats(stats_);
 	}
 
+	void SetEntropyCoder(EntropyCoder::CoderEnum coder_)
+	{
+		modeler->SetEntropyCoder(coder_);
+	}
+
 	void Encode(core::BitMemoryWriter& writer_, const fq::FastqRecord* records_, uint32 recordsCount_)
 	{
 		modeler->Encode(writer_, records_, recordsCount_);
@@ -158,6 +174,24 @@ public:
 		modeler->Decode(reader_, records_, recordsCount_);
 	}
 
+	static uint64 MemorySize(uint32 order_)
+	{
+		switch (order_)
+		{
+			case 1:	return TQualityLossyOrderPositionalModeler<8, 1>::MemorySize();
+			case 2:	return TQualityLossyOrderPositionalModeler<8, 2>::MemorySize();
+			case 3:	return TQualityLossyOrderPositionalModeler<8, 3>::MemorySize();
+			case 4:	return TQualityLossyOrderPositionalModeler<8, 4>::MemorySize();
+			case 5:	return TQualityLossyOrderPositionalModeler<8, 5>::MemorySize();
+			case 6:	return TQualityLossyOrderPositionalModeler<8, 6>::MemorySize();
+			case 7:	return TQualityLossyOrderPositionalModeler<8, 7>::MemorySize();
+			case 8:	return TQualityLossyOrderPositionalModeler<8, 8>::MemorySize();
+			case 9:	return TQualityLossyOrderPositionalModeler<8, 9>::MemorySize();
+		}
+
+		return 0;
+	}
+
 private:
 	IQualityModeler* modeler;
 
@@ -202,6 +236,30 @@ public:
 		}
 	}
 
+	// the schemes are created on demand, usually a dataset needs only one
+	// of them, so the largest one of the order is taken
+	//
+	static uint64 MemorySize(uint32 order_)
+	{
+		uint64 sizes[4];
+		if (order_ == 1)
+		{
+			sizes[0] = TQualityLosslessOrderTranslationalModeler<16, 3, 16>::MemorySize();
+			sizes[1] = TQualityLosslessOrderTranslationalModeler<32, 2, 32>::MemorySize();
+			sizes[2] = TQualityLosslessOrderTranslationalModeler<64, 1, 64>::MemorySize();
+			sizes[3] = TQualityLosslessOrderTranslationalModeler<128, 1, 128>::MemorySize();
+		}
+		else
+		{
+			sizes[0] = TQualityLosslessOrderTranslationalModeler<16, 4, 16>::MemorySize();
+			sizes[1] = TQualityLosslessOrderTranslationalModeler<32, 3, 32>::MemorySize();
+			sizes[2] = TQualityLosslessOrderTranslationalModeler<64, 2, 64>::MemorySize();
+			sizes[3] = TQualityLosslessOrderTranslationalModeler<128, 1, 128>::MemorySize();
+		}
+
+		return *std::max_element(sizes, sizes + 4);
+	}
+
 private:
 	static const uint32 ModelersCount = 4 * 2;
 
@@ -28,18 +28,57 @@ template <class _TQualityEncoder>
 class TQualityOrderModeler : public IQualityModeler
 {
 public:
+	TQualityOrderModeler()
+		:	entropyCoder(EntropyCoder::Range)
+	{}
+
 	void ProcessStats(const QualityStats& stats_)
 	{
 		encoder.ProcessStats(stats_);
 	}
 
+	void SetEntropyCoder(EntropyCoder::CoderEnum coder_)
+	{
+		entropyCoder = coder_;
+	}
+
 	void Encode(core::BitMemoryWriter& writer_, const fq::FastqRecord* records_, uint32 recordsCount_)
+	{
+		if (entropyCoder == EntropyCoder::Rans)
+			EncodeRecords<RansEncoder>(writer_, records_, recordsCount_);
+		else
+			EncodeRecords<RangeEncoder>(writer_, records_, recordsCount_);
+	}
+
+	void Decode(core::BitMemoryReader& reader_, fq::FastqRecord* records_, uint32 recordsCount_)
+	{
+		if (entropyCoder == EntropyCoder::Rans)
+			DecodeRecords<RansDecoder>(reader_, records_, recordsCount_);
+		else
+			DecodeRecords<RangeDecoder>(reader_, records_, recordsCount_);
+	}
+
+	static uint64 MemorySize()
+	{
+		return sizeof(TQualityOrderModeler) + Model::TableSize();
+	}
+
+private:
+	typedef _TQualityEncoder Encoder;
+	typedef typename Encoder::Model Model;
+
+	Model model;
+	Encoder encoder;
+	EntropyCoder::CoderEnum entropyCoder;
+
+	template <class _TEncoder>
+	void EncodeRecords(core::BitMemoryWriter& writer_, const fq::FastqRecord* records_, uint32 recordsCount_)
 	{
 		encoder.Store(writer_);
 
 		model.Clear();
 
-		RangeEncoder coder(writer_);
+		_TEncoder coder(writer_);
 		coder.Start();
 
 		for (uint32 i = 0; i < recordsCount_; ++i)
@@ -50,13 +89,14 @@ public:
 		coder.End();
 	}
 
-	void Decode(core::BitMemoryReader& reader_, fq::FastqRecord* records_, uint32 recordsCount_)
+	template <class _TDecoder>
+	void DecodeRecords(core::BitMemoryReader& reader_, fq::FastqRecord* records_, uint32 recordsCount_)
 	{
 		encoder.Read(reader_);
 
 		model.Clear();
 
-		RangeDecoder coder(reader_);
+		_TDecoder coder(reader_);
 		coder.Start();
 
 		for (uint32 i = 0; i < recordsCount_; ++i)
@@ -66,13 +106,6 @@ public:
 		}
 		coder.End();
 	}
-
-private:
-	typedef _TQualityEncoder Encoder;
-	typedef typename Encoder::Model Model;
-
-	Model model;
-	Encoder encoder;
 };
 
 
@@ -0,0 +1,245 @@
+/*
+  This file is a part of DSRC software distributed under GNU GPL 2 licence.
+  The homepage of the DSRC project is http://sun.aei.polsl.pl/dsrc
+
+  Authors: Lucas Roguski and Sebastian Deorowicz
+
+  Version: 2.00
+*/
+
+#ifndef H_RANSCODER
+#define H_RANSCODER
+
+#include "../include/dsrc/Globals.h"
+
+#include <vector>
+
+#include "BitMemory.h"
+
+namespace dsrc
+{
+
+namespace comp
+{
+
+// Interleaved rANS coder, a drop-in replacement of the range coder for the
+// adaptive models: the consecutive symbols are coded by separate states in
+// turn, so decoding a symbol does not wait for the previous one's state.
+//
+// The models frequencies are exact, but their totals are arbitrary, so
+// every symbol interval is mapped onto the fixed 2^16 scale -- each one is
+// kept at least as wide as it was, thus the mapping loses almost nothing.
+//
+// rANS codes the symbols in the reverse order, so the encoder buffers them
+// and codes them in segments, each closed by the final states
+//
+template <uint32 _TStateCount>
+class TRansCoder
+{
+public:
+	typedef uint32 State;
+	typedef uint32 Freq;
+
+	static const uint32 StateCount = _TStateCount;
+	static const uint32 ScaleBits = 16;
+	static const Freq ScaleRange = 1 << ScaleBits;
+	static const State LowerBound = 1 << 16;			// states are kept in [2^16, 2^32) and
+	static const uint32 WordBits = 16;					// renormalized by 16 bits at once
+	static const uint32 SegmentSize = 1 << 16;			// symbols coded between the states flushes
+
+protected:
+	// position of the cumulative frequency on the fixed scale
+	//
+	static Freq Scale(Freq cumFreq_, Freq totalFreq_)
+	{
+		return (cumFreq_ << ScaleBits) / totalFreq_;
+	}
+};
+
+
+template <uint32 _TStateCount>
+class TRansEncoder : private TRansCoder<_TStateCount>
+{
+	typedef TRansCoder<_TStateCount> Coder;
+	typedef typename Coder::State State;
+	typedef typename Coder::Freq Freq;
+
+	using Coder::StateCount;
+	using Coder::ScaleBits;
+	using Coder::ScaleRange;
+	using Coder::LowerBound;
+	using Coder::WordBits;
+	using Coder::SegmentSize;
+
+public:
+	TRansEncoder(core::BitMemoryWriter& byteStream_)
+		:	byteStream(byteStream_)
+	{
+		symbols.reserve(SegmentSize);
+		words.reserve(SegmentSize + StateCount * 2);
+	}
+
+	void Start()
+	{
+		symbols.clear();
+	}
+
+	void EncodeFrequency(Freq symFreq_, Freq cumFreq_, Freq totalFreqSum_)
+	{
+		ASSERT(totalFreqSum_ <= ScaleRange);
+		ASSERT(symFreq_ != 0 && cumFreq_ + symFreq_ <= totalFreqSum_);
+
+		const Freq lo = Coder::Scale(cumFreq_, totalFreqSum_);
+		const Freq hi = Coder::Scale(cumFreq_ + symFreq_, totalFreqSum_);
+
+		symbols.push_back(lo | ((hi - lo - 1) << ScaleBits));
+
+		if (symbols.size() == SegmentSize)
+			FlushSegment();
+	}
+
+	void End()
+	{
+		if (symbols.size() > 0)
+			FlushSegment();
+	}
+
+private:
+	core::BitMemoryWriter& byteStream;
+
+	std::vector<uint32> symbols;			// the scaled intervals: low end and size - 1
+	std::vector<uint16> words;				// segment output, in the reverse order
+
+	void FlushSegment()
+	{
+		State states[StateCount];
+		for (uint32 i = 0; i < StateCount; ++i)
+			states[i] = LowerBound;
+
+		words.clear();
+		for (uint32 i = (uint32)symbols.size(); i-- > 0; )
+		{
+			State& x = states[i % StateCount];
+			const Freq lo = symbols[i] & (ScaleRange - 1);
+			const Freq freq = (symbols[i] >> ScaleBits) + 1;
+
+			if ((uint64)x >= (uint64)freq << (32 - ScaleBits))
+			{
+				words.push_back((uint16)x);
+				x >>= WordBits;
+			}
+			x = ((x / freq) << ScaleBits) + (x % freq) + lo;
+		}
+
+		// the decoder reads the states first, starting with the first one
+		//
+		for (uint32 i = StateCount; i-- > 0; )
+		{
+			words.push_back((uint16)states[i]);
+			words.push_back((uint16)(states[i] >> WordBits));
+		}
+
+		for (uint32 i = (uint32)words.size(); i-- > 0; )
+		{
+			byteStream.PutByte(words[i] >> 8);
+			byteStream.PutByte(words[i] & 0xFF);
+		}
+
+		symbols.clear();
+	}
+};
+
+
+template <uint32 _TStateCount>
+class TRansDecoder : private TRansCoder<_TStateCount>
+{
+	typedef TRansCoder<_TStateCount> Coder;
+	typedef typename Coder::State State;
+	typedef typename Coder::Freq Freq;
+
+	using Coder::StateCount;
+	using Coder::ScaleBits;
+	using Coder::ScaleRange;
+	using Coder::LowerBound;
+	using Coder::WordBits;
+	using Coder::SegmentSize;
+
+public:
+	TRansDecoder(core::BitMemoryReader& byteStream_)
+		:	byteStream(byteStream_)
+		,	symbolIdx(SegmentSize)
+	{}
+
+	void Start()
+	{
+		// the states are read on the first symbol, as an empty stream has none
+		//
+		symbolIdx = SegmentSize;
+	}
+
+	Freq GetCumulativeFreq(Freq totalFreq_)
+	{
+		ASSERT(totalFreq_ != 0 && totalFreq_ <= ScaleRange);
+
+		if (symbolIdx == SegmentSize)
+			ReadStates();
+
+		// the largest cumulative frequency not mapped past the slot
+		//
+		const Freq slot = states[symbolIdx % StateCount] & (ScaleRange - 1);
+		return (Freq)(((uint64)(slot + 1) * totalFreq_ - 1) >> ScaleBits);
+	}
+
+	void UpdateFrequency(Freq symFreq_, Freq lowEnd_, Freq totalFreq_)
+	{
+		const Freq lo = Coder::Scale(lowEnd_, totalFreq_);
+		const Freq hi = Coder::Scale(lowEnd_ + symFreq_, totalFreq_);
+
+		State& x = states[symbolIdx % StateCount];
+		x = (hi - lo) * (x >> ScaleBits) + (x & (ScaleRange - 1)) - lo;
+
+		if (x < LowerBound)
+			x = (x << WordBits) | GetWord();
+
+		symbolIdx++;
+	}
+
+	void End()
+	{}
+
+private:
+	core::BitMemoryReader& byteStream;
+
+	State states[StateCount];
+	uint32 symbolIdx;
+
+	uint32 GetWord()
+	{
+		uint32 w = byteStream.GetByte() << 8;
+		return w | byteStream.GetByte();
+	}
+
+	void ReadStates()
+	{
+		for (uint32 i = 0; i < StateCount; ++i)
+		{
+			states[i] = GetWord() << WordBits;
+			states[i] |= GetWord();
+		}
+		symbolIdx = 0;
+	}
+};
+
+
+// number of the interleaved states, part of the stream format
+//
+static const uint32 RansStateCount = 8;
+
+typedef TRansEncoder<RansStateCount> RansEncoder;
+typedef TRansDecoder<RansStateCount> RansDecoder;
+
+} // namespace comp
+
+} // namespace dsrc
+
+#endif // H_RANSCODER
@@ -174,6 +174,14 @@ fq::FastqChecksum IRecordsProcessor::ProcessBackward(FastqRecord *records_, uint
 	return fastqHasher.GetChecksum();
 }
 
+void IRecordsProcessor::ProcessSequencesBackward(FastqRecord *records_, uint64 recordsCount_)
+{
+	ASSERT(!colorSpace);
+
+	for (uint64 i = 0; i < recordsCount_; ++i)
+		ProcessSequenceBackward(records_[i]);
+}
+
 
 // Lossless processor
 //
@@ -314,6 +322,15 @@ void LosslessRecordsProcessor::ProcessBackward(FastqRecord &rec_)
 	}
 }
 
+void LosslessRecordsProcessor::ProcessSequenceBackward(FastqRecord &rec_)
+{
+	for (uint32 i = 0; i < rec_.sequenceLen; ++i)
+	{
+		ASSERT(rec_.sequence[i] < DnaStats::MaxSymbolCount);
+		rec_.sequence[i] = dnaFromIndexTable[rec_.sequence[i]];
+	}
+}
+
 
 LossyRecordsProcessor::LossyRecordsProcessor(uint32 qualityOffset_, bool colorSpace_)
 	:	LosslessRecordsProcessor(qualityOffset_, colorSpace_)
@@ -116,6 +116,14 @@ public:
 	fq::FastqChecksum ProcessForward(fq::FastqRecord* records_, uint64 recordsCount_, uint32 flags_ = fq::FastqChecksum::CALC_NONE);
 	fq::FastqChecksum ProcessBackward(fq::FastqRecord* records_, uint64 recordsCount_, uint32 flags_ = fq::FastqChecksum::CALC_NONE);
 
+	// transforms only the sequences, when the ambiguous symbols are already
+	// restored at their positions
+	void ProcessSequencesBackward(fq::FastqRecord* records_, uint64 recordsCount_);
+
+	// checks whether the ambiguous DNA symbol was moved to the quality stream,
+	// works on the preprocessed records
+	virtual bool IsSymbolMoved(uchar quality_, uchar& dnaSymbol_) const = 0;
+
 	const DnaStats& GetDnaStats() const
 	{
 		return dnaStats;
@@ -155,6 +163,7 @@ private:
 
 	virtual void ProcessForward(fq::FastqRecord &rec_) = 0;
 	virtual void ProcessBackward(fq::FastqRecord &rec_) = 0;
+	virtual void ProcessSequenceBackward(fq::FastqRecord &rec_) = 0;
 };
 
 class LosslessRecordsProcessor : public IRecordsProcessor
@@ -162,6 +171,15 @@ class LosslessRecordsProcessor : public IRecordsProcessor
 public:
 	LosslessRecordsProcessor(uint32 qualityOffset_, bool colorSpace_);
 
+	bool IsSymbolMoved(uchar quality_, uchar& dnaSymbol_) const
+	{
+		if (quality_ < 128)
+			return false;
+
+		dnaSymbol_ = (quality_ - 128 + 16)/8 + 3 - 1;
+		return true;
+	}
+
 protected:
 	uchar dnaToIndexTable[128];
 	uchar dnaFromIndexTable[DnaStats::MaxSymbolCount];
@@ -169,6 +187,7 @@ protected:
 private:
 	void ProcessForward(fq::FastqRecord &rec_);
 	void ProcessBackward(fq::FastqRecord &rec_);
+	void ProcessSequenceBackward(fq::FastqRecord &rec_);
 };
 
 
@@ -177,6 +196,15 @@ class LossyRecordsProcessor : public LosslessRecordsProcessor
 public:
 	LossyRecordsProcessor(uint32 qualityOffset_, bool colorSpace_);
 
+	bool IsSymbolMoved(uchar quality_, uchar& dnaSymbol_) const
+	{
+		if (quality_ != 0)
+			return false;
+
+		dnaSymbol_ = 4;
+		return true;
+	}
+
 	void FinalizeStats()
 	{
 		IRecordsProcessor::FinalizeStats();
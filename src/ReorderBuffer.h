@@ -0,0 +1,187 @@
+/*
+  This file is a part of DSRC software distributed under GNU GPL 2 licence.
+  The homepage of the DSRC project is http://sun.aei.polsl.pl/dsrc
+  
+  Authors: Lucas Roguski and Sebastian Deorowicz
+  
+  Version: 2.00
+*/
+
+#ifndef H_REORDERBUFFER
+#define H_REORDERBUFFER
+
+#include "../include/dsrc/Globals.h"
+
+#include <vector>
+
+#ifdef USE_BOOST_THREAD
+#include <boost/date_time/posix_time/posix_time_types.hpp>
+#else
+#include <chrono>
+#endif
+
+namespace dsrc
+{
+
+namespace core
+{
+
+struct ReorderStats
+{
+	uint64 partsNum;
+	uint64 waitedPartsNum;			// parts which arrived ahead of their turn
+	uint64 totalWaitUs;
+	uint64 maxWaitUs;
+
+	ReorderStats()
+		:	partsNum(0)
+		,	waitedPartsNum(0)
+		,	totalWaitUs(0)
+		,	maxWaitUs(0)
+	{}
+};
+
+
+// Restores the order of the parts processed concurrently: the parts are
+// kept in a ring indexed by their ids, sized to the number of parts which
+// can be in flight, and taken out only in sequence
+//
+template <class _TDataType>
+class TReorderBuffer
+{
+	typedef _TDataType DataType;
+
+	struct Slot
+	{
+		int64 partId;
+		DataType* part;
+		uint64 arrivalTime;
+	};
+
+	std::vector<Slot> slots;
+	int64 nextPartId;
+	uint32 bufferedNum;
+
+	ReorderStats stats;
+
+	static uint64 Now()
+	{
+#ifdef USE_BOOST_THREAD
+		using namespace boost::posix_time;
+		static const ptime epoch = microsec_clock::universal_time();
+		return (microsec_clock::universal_time() - epoch).total_microseconds();
+#else
+		using namespace std::chrono;
+		return duration_cast<microseconds>(steady_clock::now().time_since_epoch()).count();
+#endif
+	}
+
+	Slot& SlotOf(int64 partId_)
+	{
+		return slots[partId_ % slots.size()];
+	}
+
+	void Grow(int64 partId_)
+	{
+		// the ring size is only an estimate of the parts in flight, so keep
+		// it correct when more parts get ahead of the next one
+		//
+		uint64 size = slots.size();
+		while ((uint64)(partId_ - nextPartId) >= size)
+			size *= 2;
+
+		std::vector<Slot> oldSlots(size, Slot());
+		oldSlots.swap(slots);
+		for (typename std::vector<Slot>::iterator i = oldSlots.begin(); i != oldSlots.end(); ++i)
+		{
+			if (i->part != NULL)
+				SlotOf(i->partId) = *i;
+		}
+	}
+
+public:
+	TReorderBuffer(uint32 capacity_)
+		:	nextPartId(0)
+		,	bufferedNum(0)
+	{
+		ASSERT(capacity_ > 0);
+
+		slots.resize(capacity_, Slot());
+	}
+
+	bool IsEmpty() const
+	{
+		return bufferedNum == 0;
+	}
+
+	const ReorderStats& GetStats() const
+	{
+		return stats;
+	}
+
+	void Push(int64 partId_, DataType* part_)
+	{
+		ASSERT(part_ != NULL);
+		ASSERT(partId_ >= nextPartId);
+
+		if ((uint64)(partId_ - nextPartId) >= slots.size())
+			Grow(partId_);
+
+		Slot& slot = SlotOf(partId_);
+		ASSERT(slot.part == NULL);
+
+		slot.partId = partId_;
+		slot.part = part_;
+		slot.arrivalTime = (partId_ != nextPartId) ? Now() : 0;
+		bufferedNum++;
+	}
+
+	// takes out the next part in sequence, if it has already arrived
+	//
+	bool Pop(DataType*& part_)
+	{
+		Slot& slot = SlotOf(nextPartId);
+		if (slot.part == NULL || slot.partId != nextPartId)
+			return false;
+
+		if (slot.arrivalTime != 0)
+		{
+			const uint64 wait = Now() - slot.arrivalTime;
+			stats.waitedPartsNum++;
+			stats.totalWaitUs += wait;
+			if (wait > stats.maxWaitUs)
+				stats.maxWaitUs = wait;
+		}
+		stats.partsNum++;
+
+		part_ = slot.part;
+		slot.part = NULL;
+		bufferedNum--;
+		nextPartId++;
+		return true;
+	}
+
+	// takes out any remaining part regardless of the order, used when
+	// the processing is aborted
+	//
+	bool Drain(DataType*& part_)
+	{
+		for (typename std::vector<Slot>::iterator i = slots.begin(); bufferedNum > 0 && i != slots.end(); ++i)
+		{
+			if (i->part != NULL)
+			{
+				part_ = i->part;
+				i->part = NULL;
+				bufferedNum--;
+				return true;
+			}
+		}
+		return false;
+	}
+};
+
+} // namespace core
+
+} // namespace dsrc
+
+#endif // H_REORDERBUFFER
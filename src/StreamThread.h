@@ -0,0 +1,154 @@
+/*
+  This file is a part of DSRC software distributed under GNU GPL 2 licence.
+  The homepage of the DSRC project is http://sun.aei.polsl.pl/dsrc
+  
+  Authors: Lucas Roguski and Sebastian Deorowicz
+  
+  Version: 2.00
+*/
+
+#ifndef H_STREAMTHREAD
+#define H_STREAMTHREAD
+
+#include "../include/dsrc/Globals.h"
+
+#include <string>
+
+#ifdef USE_BOOST_THREAD
+#include <boost/thread.hpp>
+namespace th = boost;
+#else
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+namespace th = std;
+#endif
+
+namespace dsrc
+{
+
+namespace core
+{
+
+// Helper thread kept alive between the jobs of its owner: Start() runs an owner
+// method on the thread, Wait() blocks until it returns and CheckError() passes
+// on an exception thrown by it -- the destructor waits for the current job and
+// joins the thread
+//
+template <class _TOwner>
+class TStreamThread
+{
+	typedef void (_TOwner::*JobMethod)();
+
+	_TOwner* const owner;
+	JobMethod job;
+	bool busy;
+	bool stopping;
+	bool failed;
+	std::string error;
+
+	th::mutex mutex;
+	th::condition_variable condition;
+	th::thread* thread;
+
+	TStreamThread(const TStreamThread&);
+	TStreamThread& operator= (const TStreamThread&);
+
+	void Run()
+	{
+		th::unique_lock<th::mutex> lock(mutex);
+		for ( ;; )
+		{
+			while (!busy && !stopping)
+				condition.wait(lock);
+
+			if (!busy)
+				return;
+
+			JobMethod method = job;
+			lock.unlock();
+
+			bool jobFailed = false;
+			std::string jobError;
+			try
+			{
+				(owner->*method)();
+			}
+			catch (const std::exception& e_)
+			{
+				jobFailed = true;
+				jobError = e_.what();
+			}
+			catch (...)
+			{
+				jobFailed = true;
+				jobError = "Unknown error in stream thread";
+			}
+
+			lock.lock();
+			failed = jobFailed;
+			error = jobError;
+			busy = false;
+			condition.notify_all();
+		}
+	}
+
+public:
+	TStreamThread(_TOwner* owner_)
+		:	owner(owner_)
+		,	job(NULL)
+		,	busy(false)
+		,	stopping(false)
+		,	failed(false)
+	{
+		thread = new th::thread(&TStreamThread::Run, this);
+	}
+
+	~TStreamThread()
+	{
+		{
+			th::lock_guard<th::mutex> lock(mutex);
+			stopping = true;
+		}
+		condition.notify_all();
+
+		thread->join();
+		delete thread;
+	}
+
+	void Start(JobMethod job_)
+	{
+		{
+			th::lock_guard<th::mutex> lock(mutex);
+			ASSERT(!busy);
+
+			job = job_;
+			busy = true;
+			failed = false;
+			error.clear();
+		}
+		condition.notify_all();
+	}
+
+	void Wait()
+	{
+		th::unique_lock<th::mutex> lock(mutex);
+		while (busy)
+			condition.wait(lock);
+	}
+
+	void CheckError()
+	{
+		th::lock_guard<th::mutex> lock(mutex);
+		ASSERT(!busy);
+
+		if (failed)
+			throw DsrcException(error);
+	}
+};
+
+} // namespace core
+
+} // namespace dsrc
+
+#endif // H_STREAMTHREAD
@@ -14,13 +14,29 @@
 
 #include "RangeCoder.h"
 
+#if defined(__i386__) || defined(__x86_64__) || defined(_M_IX86) || defined(_M_X64)
+#include <emmintrin.h>
+#define SSE2_SYMBOL_STATS 1
+#else
+#define SSE2_SYMBOL_STATS 0
+#endif
+
 namespace dsrc
 {
 
 namespace comp
 {
 
-template <uint32 _TMaxSymbolCount>
+// Alphabets at least this large, and a multiple of the vector width, have
+// the cumulative frequencies computed and searched with SSE2, smaller ones
+// are summed and searched faster linearly
+//
+static const uint32 VectorStatsMinSymbolCount = 16;
+
+template <uint32 _TMaxSymbolCount,
+		  bool _TVectorStats = (SSE2_SYMBOL_STATS
+								&& _TMaxSymbolCount >= VectorStatsMinSymbolCount
+								&& _TMaxSymbolCount % 8 == 0)>
 class TSymbolCoderRC
 {
 public:
@@ -32,7 +48,13 @@ public:
 		std::fill(stats, stats + MaxSymbolCount, 1);
 	}
 
-	void EncodeSymbol(RangeEncoder& rc_, uint32 sym_)
+	void Clear()
+	{
+		std::fill(stats, stats + MaxSymbolCount, 1);
+	}
+
+	template <class _TEncoder>
+	void EncodeSymbol(_TEncoder& rc_, uint32 sym_)
 	{
 		ASSERT(sym_ < MaxSymbolCount);
 
@@ -47,7 +69,8 @@ public:
 		stats[sym_] += StepSize;
 	}
 
-	uint32 DecodeSymbol(RangeDecoder& rc_)
+	template <class _TDecoder>
+	uint32 DecodeSymbol(_TDecoder& rc_)
 	{
 		uint32 acc = Accumulate();
 		uint32 cul = rc_.GetCumulativeFreq(acc);
@@ -92,6 +115,252 @@ private:
 	StatType stats[MaxSymbolCount];			// can be assumed to be uint16
 };
 
+
+#if SSE2_SYMBOL_STATS
+
+// Coder for the larger alphabets: the prefix sums of all the stats are
+// computed 8 at a time in vector registers, giving both the total and the
+// cumulative frequency in one pass, and the decoded symbol is found by
+// counting the prefix sums not above the target instead of scanning.
+// Produces exactly the same output as the linear coder
+//
+template <uint32 _TMaxSymbolCount>
+class TSymbolCoderRC<_TMaxSymbolCount, true>
+{
+public:
+	typedef uint16 StatType;
+	static const uint32 MaxSymbolCount = _TMaxSymbolCount;
+
+	TSymbolCoderRC()
+	{
+		std::fill(stats, stats + MaxSymbolCount, 1);
+	}
+
+	void Clear()
+	{
+		std::fill(stats, stats + MaxSymbolCount, 1);
+	}
+
+	template <class _TEncoder>
+	void EncodeSymbol(_TEncoder& rc_, uint32 sym_)
+	{
+		ASSERT(sym_ < MaxSymbolCount);
+
+		__m128i sums[VectorCount];
+		uint32 acc = Accumulate(sums);
+		uint32 loEnd = (sym_ > 0) ? PrefixSum(sums, sym_ - 1) : 0;
+
+		rc_.EncodeFrequency(stats[sym_], loEnd, acc);
+
+		stats[sym_] += StepSize;
+	}
+
+	template <class _TDecoder>
+	uint32 DecodeSymbol(_TDecoder& rc_)
+	{
+		__m128i sums[VectorCount];
+		uint32 acc = Accumulate(sums);
+		uint32 cul = rc_.GetCumulativeFreq(acc);
+		ASSERT(cul < acc);
+
+		// the symbol index is the number of prefix sums <= cul, counted
+		// as lanes where the saturated (sum - cul) is zero
+		//
+		const __m128i target = _mm_set1_epi16((short)cul);
+		const __m128i zero = _mm_setzero_si128();
+		__m128i count = zero;
+		for (uint32 v = 0; v < VectorCount; ++v)
+			count = _mm_sub_epi16(count, _mm_cmpeq_epi16(_mm_subs_epu16(sums[v], target), zero));
+
+		count = _mm_add_epi16(count, _mm_srli_si128(count, 8));
+		count = _mm_add_epi16(count, _mm_srli_si128(count, 4));
+		count = _mm_add_epi16(count, _mm_srli_si128(count, 2));
+		uint32 idx = _mm_cvtsi128_si32(count) & 0xFFFF;
+		ASSERT(idx < MaxSymbolCount);
+
+		uint32 loEnd = (idx > 0) ? PrefixSum(sums, idx - 1) : 0;
+
+		rc_.UpdateFrequency(stats[idx], loEnd, acc);
+		stats[idx] += StepSize;
+		return idx;
+	}
+
+private:
+	static const StatType StepSize = 2;
+	static const uint32 MaxAccumulatedValue = (1<<16) - MaxSymbolCount*StepSize;
+	static const uint32 LaneCount = sizeof(__m128i) / sizeof(StatType);
+	static const uint32 VectorCount = MaxSymbolCount / LaneCount;
+
+	void Rescale()
+	{
+		for (uint32 i = 0; i < MaxSymbolCount; ++i)
+			stats[i] -= stats[i] >> 1;		// no '>>=' to avoid reducing stats to 0
+	}
+
+	// inclusive prefix sums of the stats, returns the total -- it stays below
+	// 2^16, so the sums never overflow the 16-bit lanes
+	//
+	uint32 PrefixSums(__m128i* sums_) const
+	{
+		__m128i carry = _mm_setzero_si128();
+		for (uint32 v = 0; v < VectorCount; ++v)
+		{
+			__m128i x = _mm_loadu_si128((const __m128i*)(stats + v * LaneCount));
+			x = _mm_add_epi16(x, _mm_slli_si128(x, 2));
+			x = _mm_add_epi16(x, _mm_slli_si128(x, 4));
+			x = _mm_add_epi16(x, _mm_slli_si128(x, 8));
+			x = _mm_add_epi16(x, carry);
+
+			// broadcast the last lane as the carry into the next vector
+			//
+			carry = _mm_shuffle_epi32(_mm_shufflehi_epi16(x, 0xFF), 0xFF);
+			sums_[v] = x;
+		}
+		return _mm_cvtsi128_si32(carry) & 0xFFFF;
+	}
+
+	uint32 Accumulate(__m128i* sums_)
+	{
+		uint32 acc = PrefixSums(sums_);
+
+		if (acc >= MaxAccumulatedValue)
+		{
+			Rescale();
+			acc = PrefixSums(sums_);
+		}
+
+		return acc;
+	}
+
+	static uint32 PrefixSum(const __m128i* sums_, uint32 sym_)
+	{
+		StatType lanes[LaneCount];
+		_mm_storeu_si128((__m128i*)lanes, sums_[sym_ / LaneCount]);
+		return lanes[sym_ % LaneCount];
+	}
+
+	StatType stats[MaxSymbolCount];
+};
+
+#endif
+
+
+// Tables of context coders at least this large are cleared lazily, smaller
+// ones are filled faster than the per-access epoch checks would cost
+//
+static const uint64 LazyClearMinTableSize = 1 << 23;
+
+// Table of context coders cleared lazily: every coder is tagged with the
+// epoch it was last used in and cleared on its first use after the table
+// was, so clearing costs only as much as the contexts used per block
+//
+template <class _TCoder, uint32 _TSize, bool _TLazyClear = ((uint64)_TSize * sizeof(_TCoder) >= LazyClearMinTableSize)>
+class TContextTable
+{
+	typedef _TCoder Coder;
+	typedef uint16 EpochType;
+
+	struct Entry
+	{
+		Coder coder;
+		EpochType epoch;
+	};
+
+	Entry* entries;
+	EpochType epoch;
+
+	TContextTable(const TContextTable&);
+	TContextTable& operator= (const TContextTable&);
+
+public:
+	TContextTable()
+		:	entries(NULL)
+		,	epoch(0)
+	{
+		entries = new Entry[_TSize];
+		for (uint32 i = 0; i < _TSize; ++i)
+			entries[i].epoch = epoch;
+	}
+
+	~TContextTable()
+	{
+		delete[] entries;
+	}
+
+	static uint64 EntriesSize()
+	{
+		return (uint64)_TSize * sizeof(Entry);
+	}
+
+	void Clear()
+	{
+		// all the coders are cleared once the epochs wrap around
+		//
+		if (++epoch == 0)
+		{
+			for (uint32 i = 0; i < _TSize; ++i)
+			{
+				entries[i].coder.Clear();
+				entries[i].epoch = epoch;
+			}
+		}
+	}
+
+	Coder& operator[] (uint32 ctx_)
+	{
+		ASSERT(ctx_ < _TSize);
+
+		Entry& e = entries[ctx_];
+		if (e.epoch != epoch)
+		{
+			e.coder.Clear();
+			e.epoch = epoch;
+		}
+		return e.coder;
+	}
+};
+
+template <class _TCoder, uint32 _TSize>
+class TContextTable<_TCoder, _TSize, false>
+{
+	typedef _TCoder Coder;
+
+	Coder* coders;
+
+	TContextTable(const TContextTable&);
+	TContextTable& operator= (const TContextTable&);
+
+public:
+	TContextTable()
+		:	coders(NULL)
+	{
+		coders = new Coder[_TSize];
+	}
+
+	~TContextTable()
+	{
+		delete[] coders;
+	}
+
+	static uint64 EntriesSize()
+	{
+		return (uint64)_TSize * sizeof(Coder);
+	}
+
+	void Clear()
+	{
+		for (uint32 i = 0; i < _TSize; ++i)
+			coders[i].Clear();
+	}
+
+	Coder& operator[] (uint32 ctx_)
+	{
+		ASSERT(ctx_ < _TSize);
+		return coders[ctx_];
+	}
+};
+
+
 class SymbolCoderRC
 {
 public:
@@ -117,7 +386,8 @@ public:
 		std::fill(stats, stats + MaxSymbolCount, 1);
 	}
 
-	void EncodeSymbol(RangeEncoder& rc_, uint32 sym_)
+	template <class _TEncoder>
+	void EncodeSymbol(_TEncoder& rc_, uint32 sym_)
 	{
 		ASSERT(sym_ < symbolCount);
 
@@ -132,7 +402,8 @@ public:
 		stats[sym_] += StepSize;
 	}
 
-	uint32 DecodeSymbol(RangeDecoder& rc_)
+	template <class _TDecoder>
+	uint32 DecodeSymbol(_TDecoder& rc_)
 	{
 		uint32 acc = Accumulate();
 		uint32 cul = rc_.GetCumulativeFreq(acc);
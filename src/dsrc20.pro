@@ -12,16 +12,23 @@ LIBS += -lpthread
 LIBS += -lboost_thread
 LIBS += -lboost_system
 
+# gzip compressed FASTQ input
+QMAKE_CXXFLAGS += -DUSE_ZLIB
+LIBS += -lz
+
 INCLUDEPATH += /usr/include/python2.7
 
 SOURCES += \
     huffman.cpp \
     DsrcFile.cpp \
     FileStream.cpp \
+    AsyncFileStream.cpp \
+    GzipFileStream.cpp \
     QualityPositionModeler.cpp \
     QualityRLEModeler.cpp \
     DnaModelerHuffman.cpp \
     RecordsProcessor.cpp \
+    Crc32.cpp \
     TagModeler.cpp \
     BlockCompressor.cpp \
     FastqParser.cpp \
@@ -48,6 +55,8 @@ HEADERS += \
     utils.h \
     huffman.h \
     FileStream.h \
+    AsyncFileStream.h \
+    GzipFileStream.h \
     FastqIo.h \
     DsrcFile.h \
     DataPool.h \
@@ -55,8 +64,12 @@ HEADERS += \
     DataQueue.h \
     Buffer.h \
     BitMemory.h \
+    BoundedQueue.h \
+    StreamThread.h \
     FastqParser.h \
+    LineScanner.h \
     RangeCoder.h \
+    RansCoder.h \
     QualityModeler.h \
     DnaModeler.h \
     DnaModelerBasicB2.h \
@@ -66,6 +79,7 @@ HEADERS += \
     QualityRLEModeler.h \
     DnaModelerHuffman.h \
     RecordsProcessor.h \
+    ReorderBuffer.h \
     QualityModelerProxy.h \
     DnaModelerProxy.h \
     Stats.h \
@@ -11,6 +11,9 @@
 
 #include <iostream>
 #include <cstring>
+#include <cstdlib>
+#include <vector>
+#include <string>
 
 #include "DsrcOperator.h"
 #include "utils.h"
@@ -26,13 +29,15 @@ struct InputArguments
 	enum ModeEnum
 	{
 		CompressMode,
-		DecompressMode
+		DecompressMode,
+		ConcatMode
 	};
 
 	static const int MinArguments = 3;
 
 	ModeEnum mode;
 	InputParameters params;
+	std::vector<std::string> concatFilenames;
 	bool verboseMode;
 
 	InputArguments()
@@ -42,6 +47,9 @@ struct InputArguments
 
 void message();
 bool parse_arguments(int argc_, const char* argv_[], InputArguments& outArgs_);
+bool parse_cat_arguments(int argc_, const char* argv_[], InputArguments& outArgs_);
+bool parse_records_range(const char* str_, InputParameters& pars_);
+bool parse_rans_streams(const char* str_, InputParameters& pars_);
 
 int main(int argc_, const char* argv_[])
 {
@@ -58,7 +66,11 @@ int main(int argc_, const char* argv_[])
 	}
 
 	IDsrcOperator* op = NULL;
-	if (args.params.threadNum == 1)
+	if (args.mode == InputArguments::ConcatMode)
+	{
+		op = new DsrcConcatenator(args.concatFilenames);
+	}
+	else if (args.params.threadNum == 1)
 	{
 		if (args.mode == InputArguments::CompressMode)
 			op = new DsrcCompressorST();
@@ -96,6 +108,7 @@ void message()
 	std::cerr << "DSRC - DNA Sequence Reads Compressor\n";
 	std::cerr << "version: " << version << "\n\n";
 	std::cerr << "usage: dsrc <c|d> [options] <input filename> <output filename>\n";
+	std::cerr << "       dsrc cat [--stream] [-v] <input dsrc filename> ... <output dsrc filename>\n";
 	std::cerr << "compression options:\n";
 	std::cerr << "\t-d<n>\t: DNA compression mode: 0-3, default: " << InputParameters::DefaultDnaCompressionLevel << '\n';
 	std::cerr << "\t-q<n>\t: Quality compression mode: 0-2, default: " << InputParameters::DefaultQualityCompressionLevel << '\n';
@@ -104,6 +117,12 @@ void message()
 	std::cerr << "\t-o<n>\t: Quality offset, default: " << InputParameters::DefaultQualityOffset << '\n';
 	std::cerr << "\t-l\t: use Quality lossy mode (Illumina binning scheme), default: " << InputParameters::DefaultLossyCompressionMode << '\n';
 	std::cerr << "\t-c\t: calculate and check CRC32 checksum calculation per block, default: " << InputParameters::DefaultCalculateCrc32 << '\n';
+	std::cerr << "\t--verify-threads <n>: threads checking the blocks compressed with -c, default: 1 per "
+			  << InputParameters::ProcessingThreadsPerVerifyThread << " processing threads\n";
+	std::cerr << "\t--stream\t: write archive sequentially without seeking back, used for pipes and '-' (stdout) output\n";
+	std::cerr << "\t--append\t: add the records to the existing archive, compressed with its settings\n";
+	std::cerr << "\t--rans <dq>\t: code the DNA (d) and/or Quality (q) streams of modes 1-3 with interleaved rANS\n"
+				 "\t\t\t  instead of the range coder, faster decompression at a ~0.1% larger size, default: off\n";
 
 	std::cerr << "automated compression modes:\n";
 	std::cerr << "\t-m<n>\t: compression mode, where n:\n";
@@ -116,6 +135,16 @@ void message()
 	std::cerr << "\t-t<n>\t: processing threads number, default (available h/w threads): " << IDsrcOperator::AvailableHardwareThreadsNum << ", max: 64" << '\n';
 	std::cerr << "\t-s\t: use stdin/stdout for reading/writing raw FASTQ data\n\n";
 	std::cerr << "\t-v\t: verbose mode, default: false\n";
+	std::cerr << "\t--mem-limit <n>\t: target memory usage in MB, fewer parts in flight, smaller blocks, lower compression\n"
+				 "\t\t\t  modes and fewer threads are used in turn to fit it, default: no limit\n";
+	std::cerr << "\t--io-threads <n>: archive or FASTQ file (regular files only) reading threads, default: 1 per "
+			  << InputParameters::ProcessingThreadsPerIoThread << " processing threads,\n"
+				 "\t\t\t  or gzip input inflating threads, default: 1 per " << InputParameters::ProcessingThreadsPerInflateThread << '\n';
+
+	std::cerr << "decompression options:\n";
+	std::cerr << "\t--records <A-B>\t: decompress only records from A to B (numbered from 1, inclusive), 'A-' till the end\n";
+	std::cerr << "\t--fasta\t\t: output records in FASTA format, skipping the quality decoding\n";
+	std::cerr << "\t--ids-only\t: output only the records ids, skipping the sequence and quality decoding\n\n";
 
 	std::cerr << "usage examples:\n";
 	std::cerr << "* compress SRR001471.fastq file saving DSRC archive to SRR001471.dsrc:\n";
@@ -128,10 +157,28 @@ void message()
 	std::cerr << "\tdsrc c -m2 -l -f1,2,3,4 SRR001471.fastq SRR001471.dsrc\n";
 	std::cerr << "* compress in the best mode reading raw FASTQ data from stdin:\n";
 	std::cerr << "\tcat SRR001471.fastq | dsrc c -m2 -s SRR001471.dsrc\n";
+	std::cerr << "* compress gzip compressed file, BGZF (bgzip) files are inflated by many threads:\n";
+	std::cerr << "\tdsrc c -m0 -t16 SRR001471.fastq.gz SRR001471.dsrc\n";
+	std::cerr << "* compress piping the archive to another program:\n";
+	std::cerr << "\tdsrc c -m0 SRR001471.fastq - | upload SRR001471.dsrc\n";
+	std::cerr << "* add the next part of the dataset to the existing archive:\n";
+	std::cerr << "\tdsrc c --append SRR001471_2.fastq SRR001471.dsrc\n";
+	std::cerr << "* compress in the best mode with 64 threads keeping the memory usage under 8 GB:\n";
+	std::cerr << "\tdsrc c -m2 -t64 --mem-limit 8192 SRR001471.fastq SRR001471.dsrc\n";
+	std::cerr << "* compress in the best mode for faster decompression:\n";
+	std::cerr << "\tdsrc c -m2 --rans dq SRR001471.fastq SRR001471.dsrc\n";
+	std::cerr << "* decompress streamed archive read from stdin:\n";
+	std::cerr << "\tcurl http://host/SRR001471.dsrc | dsrc d - SRR001471.out.fastq\n";
 	std::cerr << "* decompress SRR001471.dsrc archive saving output FASTQ file to SRR001471.out.fastq:\n";
 	std::cerr << "\tdsrc d SRR001471.dsrc SRR001471.out.fastq\n";
 	std::cerr << "* decompress archive using 4 threads and streaming raw FASTQ data to stdout:\n";
 	std::cerr << "\tdsrc d -t4 -s SRR001471.dsrc > SRR001471.out.fastq\n";
+	std::cerr << "* decompress only records from 1000001 to 2000000:\n";
+	std::cerr << "\tdsrc d --records 1000001-2000000 SRR001471.dsrc SRR001471.part.fastq\n";
+	std::cerr << "* decompress archive to FASTA format:\n";
+	std::cerr << "\tdsrc d --fasta SRR001471.dsrc SRR001471.fasta\n";
+	std::cerr << "* join archives compressed with the same settings without recompression:\n";
+	std::cerr << "\tdsrc cat SRR001471_1.dsrc SRR001471_2.dsrc SRR001471.dsrc\n";
 }
 
 bool parse_arguments(int argc_, const char* argv_[], InputArguments& outArgs_)
@@ -139,6 +186,9 @@ bool parse_arguments(int argc_, const char* argv_[], InputArguments& outArgs_)
 	if (argc_ < InputArguments::MinArguments + 1)
 		return false;
 
+	if (strcmp(argv_[1], "cat") == 0)
+		return parse_cat_arguments(argc_, argv_, outArgs_);
+
 	if (argv_[1][0] != 'c' && argv_[1][0] != 'd')
 	{
 		std::cerr << "Error: invalid mode specified\n";
@@ -159,6 +209,81 @@ bool parse_arguments(int argc_, const char* argv_[], InputArguments& outArgs_)
 		if (param[0] != '-')
 			continue;
 
+		// long options
+		//
+		if (param[1] == '-')
+		{
+			if (strcmp(param + 2, "records") == 0 && i + 1 < argc_ - 1)
+			{
+				if (!parse_records_range(argv_[++i], pars))
+				{
+					std::cerr << "Error: invalid records range specified\n";
+					return false;
+				}
+			}
+			else if (strcmp(param + 2, "stream") == 0)
+			{
+				pars.streamedArchive = true;
+			}
+			else if (strcmp(param + 2, "append") == 0)
+			{
+				pars.appendArchive = true;
+			}
+			else if (strcmp(param + 2, "rans") == 0 && i + 1 < argc_ - 1)
+			{
+				if (!parse_rans_streams(argv_[++i], pars))
+				{
+					std::cerr << "Error: invalid rANS streams specified, use 'd', 'q' or 'dq'\n";
+					return false;
+				}
+			}
+			else if (strcmp(param + 2, "io-threads") == 0 && i + 1 < argc_ - 1)
+			{
+				const char* val = argv_[++i];
+				pars.ioThreadNum = to_num((const uchar*)val, strlen(val));
+				if (pars.ioThreadNum == 0 || pars.ioThreadNum > 64)
+				{
+					std::cerr << "Error: invalid I/O thread number specified [1-64]\n";
+					return false;
+				}
+			}
+			else if (strcmp(param + 2, "verify-threads") == 0 && i + 1 < argc_ - 1)
+			{
+				const char* val = argv_[++i];
+				pars.verifyThreadNum = to_num((const uchar*)val, strlen(val));
+				if (pars.verifyThreadNum == 0 || pars.verifyThreadNum > 64)
+				{
+					std::cerr << "Error: invalid verifying thread number specified [1-64]\n";
+					return false;
+				}
+			}
+			else if (strcmp(param + 2, "mem-limit") == 0 && i + 1 < argc_ - 1)
+			{
+				const char* val = argv_[++i];
+				pars.memoryLimitMB = to_num((const uchar*)val, strlen(val));
+				if (pars.memoryLimitMB == InputParameters::NoMemoryLimit)
+				{
+					std::cerr << "Error: invalid memory limit specified\n";
+					return false;
+				}
+			}
+			else if (strcmp(param + 2, "fasta") == 0 || strcmp(param + 2, "ids-only") == 0)
+			{
+				if (pars.outputFormat != OutputFormat::Fastq)
+				{
+					std::cerr << "Error: only one of --fasta and --ids-only can be specified\n";
+					return false;
+				}
+				pars.outputFormat = (param[2] == 'f') ? OutputFormat::Fasta : OutputFormat::TagsOnly;
+			}
+			else
+			{
+				std::cerr << "Error: unknown option: " << param << '\n';
+				return false;
+			}
+			continue;
+		}
+
 		int pval = -1;
 		int len = strlen(param);
 		if (len > 2)
@@ -243,6 +368,45 @@ bool parse_arguments(int argc_, const char* argv_[], InputArguments& outArgs_)
 
 	// check params
 	//
+	if (outArgs_.mode == InputArguments::CompressMode && pars.IsRecordsRangeSet())
+	{
+		std::cerr << "Error: records range can be specified only for decompression\n";
+		return false;
+	}
+
+	if (outArgs_.mode == InputArguments::CompressMode && pars.outputFormat != OutputFormat::Fastq)
+	{
+		std::cerr << "Error: output format can be specified only for decompression\n";
+		return false;
+	}
+
+	if (outArgs_.mode == InputArguments::DecompressMode && pars.streamedArchive)
+	{
+		std::cerr << "Error: streamed archive layout can be specified only for compression\n";
+		return false;
+	}
+
+	if (outArgs_.mode == InputArguments::DecompressMode && pars.verifyThreadNum != InputParameters::AutoVerifyThreadNum)
+	{
+		std::cerr << "Error: verifying thread number can be specified only for compression\n";
+		return false;
+	}
+
+	if (pars.appendArchive)
+	{
+		if (outArgs_.mode == InputArguments::DecompressMode)
+		{
+			std::cerr << "Error: appending can be specified only for compression\n";
+			return false;
+		}
+
+		if (pars.streamedArchive || pars.outputFilename == "-")
+		{
+			std::cerr << "Error: the appended archive keeps its layout and needs to be a regular file\n";
+			return false;
+		}
+	}
+
 	if (pars.inputFilename == pars.outputFilename)
 	{
 		std::cerr << "Error: input and output filenames are the same\n";
@@ -253,11 +417,13 @@ bool parse_arguments(int argc_, const char* argv_[], InputArguments& outArgs_)
 	{
 		std::string* fastqFilename = NULL;
 		std::string* dsrcFilename = NULL;
+		bool gzipFastq = false;
 		if (outArgs_.mode == InputArguments::CompressMode)
 		{
 			if (!pars.useFastqStdIo)
 				fastqFilename = &pars.inputFilename;
 			dsrcFilename = &pars.outputFilename;
+			gzipFastq = ends_with(pars.inputFilename, ".fastq.gz");
 		}
 		else
 		{
@@ -266,10 +432,10 @@ bool parse_arguments(int argc_, const char* argv_[], InputArguments& outArgs_)
 			dsrcFilename = &pars.inputFilename;
 		}
 
-		if (fastqFilename != NULL && !ends_with(*fastqFilename, ".fastq"))
+		if (fastqFilename != NULL && pars.outputFormat == OutputFormat::Fastq && !ends_with(*fastqFilename, ".fastq") && !gzipFastq)
 			std::cerr << "Warning: passing a FASTQ file without '.fastq' extension\n";
 
-		if (dsrcFilename != NULL && !ends_with(*dsrcFilename, ".dsrc"))
+		if (dsrcFilename != NULL && *dsrcFilename != "-" && !ends_with(*dsrcFilename, ".dsrc"))
 			std::cerr << "Warning: passing a DSRC file without '.dsrc' extension\n";
 	}
 
@@ -297,12 +463,106 @@ bool parse_arguments(int argc_, const char* argv_[], InputArguments& outArgs_)
 		return false;
 	}
 
-	if ( !(pars.fastqBufferSizeMB >= 1 && pars.fastqBufferSizeMB <= 1024) )		// limit to 1GB ATM ;)
+	if ( !(pars.fastqBufferSizeMB >= 1 && pars.fastqBufferSizeMB <= InputParameters::MaxFastqBufferSizeMB) )
 	//	   && (pars.fastqBufferSizeMB & (pars.fastqBufferSizeMB - 1)) == 0) )
 	{
-		std::cerr << "Error: invalid fastq buffer size specified [1-1024] \n";
+		std::cerr << "Error: invalid fastq buffer size specified [1-" << InputParameters::MaxFastqBufferSizeMB << "] \n";
 		return false;
 	}
 
 	return true;
 }
+
+bool parse_cat_arguments(int argc_, const char* argv_[], InputArguments& outArgs_)
+{
+	outArgs_.mode = InputArguments::ConcatMode;
+	outArgs_.params = InputParameters::Default();
+	InputParameters& pars = outArgs_.params;
+
+	for (int i = 2; i < argc_ - 1; ++i)
+	{
+		const char* param = argv_[i];
+		if (strcmp(param, "--stream") == 0)
+			pars.streamedArchive = true;
+		else if (strcmp(param, "-v") == 0)
+			outArgs_.verboseMode = true;
+		else if (param[0] == '-' && param[1] != '\0')
+		{
+			std::cerr << "Error: unknown option: " << param << '\n';
+			return false;
+		}
+		else
+			outArgs_.concatFilenames.push_back(param);
+	}
+	pars.outputFilename = argv_[argc_-1];
+
+	if (outArgs_.concatFilenames.size() == 0)
+	{
+		std::cerr << "Error: no input archives specified\n";
+		return false;
+	}
+
+	// '-' stands for stdin/stdout, which can be read only once
+	//
+	uint32 stdinCount = 0;
+	for (uint32 i = 0; i < outArgs_.concatFilenames.size(); ++i)
+	{
+		if (outArgs_.concatFilenames[i] == "-")
+		{
+			if (++stdinCount > 1)
+			{
+				std::cerr << "Error: stdin can be passed as input only once\n";
+				return false;
+			}
+		}
+		else if (outArgs_.concatFilenames[i] == pars.outputFilename)
+		{
+			std::cerr << "Error: input and output filenames are the same\n";
+			return false;
+		}
+	}
+
+	if (pars.outputFilename != "-" && !ends_with(pars.outputFilename, ".dsrc"))
+		std::cerr << "Warning: passing a DSRC file without '.dsrc' extension\n";
+
+	return true;
+}
+
+bool parse_records_range(const char* str_, InputParameters& pars_)
+{
+	// format: A-B or A-, records are numbered from 1
+	//
+	char* end = NULL;
+	uint64 first = strtoull(str_, &end, 10);
+	if (end == str_ || *end != '-' || first == 0)
+		return false;
+
+	const char* last = end + 1;
+	pars_.recordsBegin = first - 1;
+	if (*last == '\0')
+		return true;
+
+	uint64 lastRec = strtoull(last, &end, 10);
+	if (end == last || *end != '\0' || lastRec < first)
+		return false;
+
+	pars_.recordsEnd = lastRec;
+	return true;
+}
+
+bool parse_rans_streams(const char* str_, InputParameters& pars_)
+{
+	// format: any of 'd' and 'q', e.g. dq
+	//
+	pars_.ransStreams = CompressionSettings::RANS_NONE;
+	for (const char* c = str_; *c != '\0'; ++c)
+	{
+		if (*c == 'd')
+			pars_.ransStreams |= CompressionSettings::RANS_DNA;
+		else if (*c == 'q')
+			pars_.ransStreams |= CompressionSettings::RANS_QUALITY;
+		else
+			return false;
+	}
+	return pars_.ransStreams != CompressionSettings::RANS_NONE;
+}